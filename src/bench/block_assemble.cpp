@@ -64,5 +64,37 @@ static void BlockAssemblerAddPackageTxns(benchmark::Bench& bench)
     });
 }
 
+static void BlockAssemblerCreateNewBlock(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    auto testing_setup{MakeNoLogFileContext<TestChain100Setup>()};
+    testing_setup->PopulateMempool(det_rand, /*num_transactions=*/1000, /*submit=*/true);
+    node::BlockAssembler::Options assembler_options;
+    assembler_options.test_block_validity = false;
+    Chainstate& chainstate{testing_setup->m_node.chainman->ActiveChainstate()};
+
+    bench.run([&] {
+        node::BlockAssembler{chainstate, testing_setup->m_node.mempool.get(), assembler_options}.CreateNewBlock(P2WSH_OP_TRUE);
+    });
+}
+
+static void BlockTemplateCacheGetTemplate(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    auto testing_setup{MakeNoLogFileContext<TestChain100Setup>()};
+    testing_setup->PopulateMempool(det_rand, /*num_transactions=*/1000, /*submit=*/true);
+    node::BlockAssembler::Options assembler_options;
+    assembler_options.test_block_validity = false;
+    node::BlockTemplateCache cache{*testing_setup->m_node.chainman, *testing_setup->m_node.mempool, assembler_options};
+    // Build the template once, as the first tip update would.
+    cache.GetTemplate(P2WSH_OP_TRUE);
+
+    bench.run([&] {
+        cache.GetTemplate(P2WSH_OP_TRUE);
+    });
+}
+
 BENCHMARK(AssembleBlock, benchmark::PriorityLevel::HIGH);
 BENCHMARK(BlockAssemblerAddPackageTxns, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockAssemblerCreateNewBlock, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateCacheGetTemplate, benchmark::PriorityLevel::LOW);
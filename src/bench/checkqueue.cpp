@@ -5,10 +5,14 @@
 #include <bench/bench.h>
 #include <checkqueue.h>
 #include <common/system.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <prevector.h>
 #include <random.h>
+#include <tinyformat.h>
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <utility>
@@ -66,3 +70,50 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     });
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, benchmark::PriorityLevel::HIGH);
+
+static const size_t SMALL_BATCHES = 2000;
+static const size_t MAX_SMALL_BATCH_SIZE = 3;
+
+// This Benchmark measures how the CheckQueue scales with the number of threads
+// on blocks with many transactions with few inputs each: checks are cheap and
+// added a few at a time, so that the overhead of handing them out dominates.
+// One curve point is reported per thread count, up to the number of cores.
+static void CCheckQueueScalingSmallJobs(benchmark::Bench& bench)
+{
+    struct SmallJob {
+        std::array<unsigned char, 32> data{};
+        bool operator()()
+        {
+            CSHA256().Write(data.data(), data.size()).Finalize(data.data());
+            return true;
+        }
+    };
+
+    FastRandomContext insecure_rand(true);
+    std::vector<std::vector<SmallJob>> vBatches(SMALL_BATCHES);
+    size_t total_jobs{0};
+    for (auto& vChecks : vBatches) {
+        vChecks.resize(1 + insecure_rand.randrange(MAX_SMALL_BATCH_SIZE));
+        total_jobs += vChecks.size();
+    }
+
+    std::vector<int> threads_nums;
+    for (int threads_num{1}; threads_num < GetNumCores(); threads_num *= 2) {
+        threads_nums.push_back(threads_num);
+    }
+    threads_nums.push_back(std::max(GetNumCores(), 1));
+
+    bench.batch(total_jobs).unit("job");
+    for (const int threads_num : threads_nums) {
+        // The main thread counts towards the threads, as in validation.
+        CCheckQueue<SmallJob> queue{QUEUE_BATCH_SIZE, threads_num - 1};
+        bench.run(strprintf("CCheckQueueScalingSmallJobs %d threads", threads_num), [&] {
+            CCheckQueueControl<SmallJob> control(&queue);
+            for (auto vChecks : vBatches) {
+                control.Add(std::move(vChecks));
+            }
+            control.Wait();
+        });
+    }
+}
+BENCHMARK(CCheckQueueScalingSmallJobs, benchmark::PriorityLevel::HIGH);
@@ -3,9 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <checkqueue.h>
 #include <cluster_linearize.h>
+#include <common/system.h>
 #include <test/util/cluster_linearize.h>
 #include <util/bitset.h>
+#include <tinyformat.h>
 #include <util/strencodings.h>
 
 #include <algorithm>
@@ -210,6 +213,32 @@ void BenchMergeLinearizationsWorstCase(ClusterIndex ntx, benchmark::Bench& bench
     });
 }
 
+/** Benchmark for linearizing many independent worst-case clusters at once, sharing one
+ *  iteration budget, on a worker queue with an increasing number of threads.
+ */
+template<typename SetType>
+void BenchLinearizeClustersScaling(ClusterIndex ntx, benchmark::Bench& bench, size_t num_clusters, uint64_t iter_limit_each)
+{
+    const std::vector<DepGraph<SetType>> depgraphs(num_clusters, MakeHardGraph<SetType>(ntx));
+
+    std::vector<int> threads_nums;
+    for (int threads_num{1}; threads_num < GetNumCores(); threads_num *= 2) {
+        threads_nums.push_back(threads_num);
+    }
+    threads_nums.push_back(std::max(GetNumCores(), 1));
+
+    bench.batch(num_clusters).unit("cluster");
+    uint64_t rng_seed = 0;
+    for (const int threads_num : threads_nums) {
+        // The calling thread counts towards the threads.
+        CCheckQueue<LinearizationJob<SetType>> queue{/*batch_size=*/1, threads_num - 1, /*thread_name=*/"linearize"};
+        bench.run(strprintf("LinearizeClusters%dx%dTx %d threads", num_clusters, ntx, threads_num), [&] {
+            const auto results = LinearizeClusters<SetType>(depgraphs, {}, num_clusters * iter_limit_each, rng_seed++, &queue);
+            assert(results.size() == num_clusters);
+        });
+    }
+}
+
 template<size_t N>
 void BenchLinearizeOptimally(benchmark::Bench& bench, const std::array<uint8_t, N>& serialized)
 {
@@ -335,6 +364,9 @@ static constexpr auto BENCH_EXAMPLE_18 = "801980c06000801980c06001801980c0600280
 /* 2023-03-31T19:24:02Z 78, 90393, 152832,*/
 static constexpr auto BENCH_EXAMPLE_19 = "800dd042008028b13c018028b13c028028b13c038029b13c048029b13c058029b13c0680299948078029b13c088029b13c09802899480a802899480b8028b13c0c80299e700d802899480e802999480f8029b13c10802999481180299948128028b13c138029b13c1480289e701580289948168028b13c1780289948188028994819802899481a802999481b802999481c802899481d802999481e8028b13c1f8029b13c20802999482180299948228028b13c2380298c242480289948258029b13c2680288c242780298c242880299e70298f5a80ea762a824780aa00292a82038090402429813fcf00152a8203809040142a813ff700112982038090402d002d813ff70028002c8203809040270024824780aa00270025820380904025002882038090401e022a82038090401d042782038090401c01298203809040190029813ff700170028813ff700140128807b9258120128841280f6402c01002e82038090402b00062b820380904027000031813ff70011192d82038090401d000129851981a9403a0000003b82038090400c182e813ff7000b0f2982038090401314141b807b925805192b84568190001121000334807bdd400149824780aa00001f2a813ff700003d0b8203809040050d1915807bdd4001498728828f400b010004050501000a050c851981a9400104050b061a0400"_hex_u8;
 
+static void LinearizeClusters64x32TxScaling(benchmark::Bench& bench) { BenchLinearizeClustersScaling<BitSet<32>>(32, bench, 64, 5000); }
+static void LinearizeClusters64x64TxScaling(benchmark::Bench& bench) { BenchLinearizeClustersScaling<BitSet<64>>(64, bench, 64, 5000); }
+
 static void LinearizeOptimallyExample00(benchmark::Bench& bench) { BenchLinearizeOptimally(bench, BENCH_EXAMPLE_00); }
 static void LinearizeOptimallyExample01(benchmark::Bench& bench) { BenchLinearizeOptimally(bench, BENCH_EXAMPLE_01); }
 static void LinearizeOptimallyExample02(benchmark::Bench& bench) { BenchLinearizeOptimally(bench, BENCH_EXAMPLE_02); }
@@ -397,6 +429,9 @@ BENCHMARK(MergeLinearizations64TxWorstCase, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MergeLinearizations75TxWorstCase, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MergeLinearizations99TxWorstCase, benchmark::PriorityLevel::HIGH);
 
+BENCHMARK(LinearizeClusters64x32TxScaling, benchmark::PriorityLevel::HIGH);
+BENCHMARK(LinearizeClusters64x64TxScaling, benchmark::PriorityLevel::HIGH);
+
 BENCHMARK(LinearizeOptimallyExample00, benchmark::PriorityLevel::HIGH);
 BENCHMARK(LinearizeOptimallyExample01, benchmark::PriorityLevel::HIGH);
 BENCHMARK(LinearizeOptimallyExample02, benchmark::PriorityLevel::HIGH);
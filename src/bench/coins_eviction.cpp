@@ -0,0 +1,109 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <consensus/amount.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <txdb.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static constexpr size_t NUM_BLOCKS{100};
+static constexpr size_t OUTPUTS_PER_BLOCK{1000};
+//! Most outputs are spent shortly after being created: this share of the
+//! spends is of outputs of the last RECENT_BLOCKS blocks.
+static constexpr int RECENT_SPEND_PERCENT{60};
+static constexpr size_t RECENT_BLOCKS{6};
+//! Small enough for the cache to fill up many times over the trace.
+static constexpr size_t CACHE_LIMIT_BYTES{4 << 20};
+
+namespace {
+struct TraceBlock {
+    std::vector<COutPoint> spends;
+    std::vector<COutPoint> creates;
+};
+
+/**
+ * Generate a mainnet-like UTXO access trace: every block creates the same
+ * number of outputs and, once some history exists, spends as many outputs,
+ * mostly recent ones and otherwise uniformly picked from the whole UTXO set.
+ */
+std::vector<TraceBlock> MakeTrace()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<TraceBlock> trace(NUM_BLOCKS);
+    // Unspent outputs, approximately in creation order.
+    std::vector<COutPoint> unspent;
+    for (auto& block : trace) {
+        if (unspent.size() > RECENT_BLOCKS * OUTPUTS_PER_BLOCK) {
+            for (size_t i{0}; i < OUTPUTS_PER_BLOCK; ++i) {
+                const size_t recent{RECENT_BLOCKS * OUTPUTS_PER_BLOCK};
+                const size_t index{int(rng.randrange(100)) < RECENT_SPEND_PERCENT ?
+                                       unspent.size() - 1 - rng.randrange(recent) :
+                                       rng.randrange(unspent.size())};
+                block.spends.push_back(unspent[index]);
+                unspent[index] = unspent.back();
+                unspent.pop_back();
+            }
+        }
+        const Txid txid{Txid::FromUint256(rng.rand256())};
+        for (uint32_t n{0}; n < OUTPUTS_PER_BLOCK; ++n) {
+            block.creates.emplace_back(txid, n);
+            unspent.push_back(block.creates.back());
+        }
+    }
+    return trace;
+}
+} // namespace
+
+/**
+ * Replay the trace on a coins cache on top of a chainstate database, writing
+ * the cache out whenever it exceeds its size limit. Either empty the cache
+ * (evict_percent of 0) or only evict its least recently used entries, down
+ * to evict_percent percent below the limit.
+ */
+static void CoinsCacheEviction(benchmark::Bench& bench, unsigned evict_percent)
+{
+    const std::vector<TraceBlock> trace{MakeTrace()};
+    const CScript script{CScript() << OP_0 << std::vector<unsigned char>(20, 1)};
+
+    bench.batch(NUM_BLOCKS).unit("block").run([&] {
+        CCoinsViewDB db{{.path = "", .cache_bytes = 8 << 20, .memory_only = true}, {}};
+        CCoinsViewCache cache{&db};
+        FastRandomContext rng{/*fDeterministic=*/true};
+        for (const auto& block : trace) {
+            for (const auto& outpoint : block.spends) {
+                const bool spent{cache.SpendCoin(outpoint)};
+                assert(spent);
+            }
+            for (const auto& outpoint : block.creates) {
+                cache.AddCoin(outpoint, Coin{CTxOut{COIN, script}, 1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+            }
+            if (cache.DynamicMemoryUsage() - cache.ReusableMemoryUsage() > CACHE_LIMIT_BYTES) {
+                cache.SetBestBlock(rng.rand256());
+                const bool flushed{evict_percent == 0 ? cache.Flush() : cache.SyncAndEvict(CACHE_LIMIT_BYTES * (100 - evict_percent) / 100)};
+                assert(flushed);
+            }
+        }
+    });
+}
+
+static void CoinsCacheFullFlush(benchmark::Bench& bench)
+{
+    CoinsCacheEviction(bench, /*evict_percent=*/0);
+}
+
+static void CoinsCachePartialEviction(benchmark::Bench& bench)
+{
+    CoinsCacheEviction(bench, /*evict_percent=*/50);
+}
+
+BENCHMARK(CoinsCacheFullFlush, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CoinsCachePartialEviction, benchmark::PriorityLevel::HIGH);
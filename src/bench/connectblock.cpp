@@ -0,0 +1,97 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data/block413567.raw.h>
+#include <coins.h>
+#include <common/system.h>
+#include <inputfetcher.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <streams.h>
+#include <txdb.h>
+
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <vector>
+
+static constexpr int BLOCK_HEIGHT{413567};
+//! Unrelated coins added to the database, so that lookups do not hit a trivially small LevelDB.
+static constexpr size_t FILLER_COINS{100'000};
+static constexpr size_t FETCHER_BATCH_SIZE{16};
+
+/**
+ * Apply the UTXO set changes of a real mainnet block to a cold cache on top of
+ * a chainstate database holding all of its inputs, optionally prefetching the
+ * inputs in parallel first. This is the part of ConnectBlock that stalls on
+ * database lookups; script and other consensus checks are not included.
+ */
+static void ConnectBlockColdCache(benchmark::Bench& bench, bool prefetch)
+{
+    DataStream stream{benchmark::data::block413567};
+    CBlock block;
+    stream >> TX_WITH_WITNESS(block);
+
+    CCoinsViewDB db{{.path = "", .cache_bytes = 8 << 20, .memory_only = true}, {}};
+    {
+        FastRandomContext rng{/*fDeterministic=*/true};
+        CCoinsViewCache cache{&db};
+        std::set<Txid> created;
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& txin : tx->vin) {
+                    if (created.contains(txin.prevout.hash)) continue;
+                    CScript script{CScript() << OP_0 << rng.randbytes(20)};
+                    cache.AddCoin(txin.prevout, Coin{CTxOut{COIN, script}, BLOCK_HEIGHT - 1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+                }
+            }
+            created.insert(tx->GetHash());
+        }
+        for (size_t i{0}; i < FILLER_COINS; ++i) {
+            CScript script{CScript() << OP_0 << rng.randbytes(20)};
+            cache.AddCoin(COutPoint{Txid::FromUint256(rng.rand256()), 0}, Coin{CTxOut{COIN, script}, 1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+        }
+        cache.SetBestBlock(block.hashPrevBlock);
+        const bool flushed{cache.Flush()};
+        assert(flushed);
+    }
+
+    // The main thread should be counted to prevent thread oversubscription.
+    std::optional<InputFetcher> fetcher;
+    if (prefetch) fetcher.emplace(FETCHER_BATCH_SIZE, GetNumCores() - 1);
+
+    bench.unit("block").run([&] {
+        CCoinsViewCache cache{&db};
+        if (fetcher) fetcher->FetchInputs(cache, db, block);
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& txin : tx->vin) {
+                    const bool spent{cache.SpendCoin(txin.prevout)};
+                    assert(spent);
+                }
+            }
+            AddCoins(cache, *tx, BLOCK_HEIGHT);
+        }
+    });
+}
+
+static void ConnectBlockColdCacheSerial(benchmark::Bench& bench)
+{
+    ConnectBlockColdCache(bench, /*prefetch=*/false);
+}
+
+static void ConnectBlockColdCachePrefetch(benchmark::Bench& bench)
+{
+    // Prefetching is disabled on a single core machine.
+    if (GetNumCores() <= 1) return;
+    ConnectBlockColdCache(bench, /*prefetch=*/true);
+}
+
+BENCHMARK(ConnectBlockColdCacheSerial, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ConnectBlockColdCachePrefetch, benchmark::PriorityLevel::HIGH);
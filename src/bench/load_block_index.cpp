@@ -0,0 +1,75 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <dbwrapper.h>
+#include <node/blockstorage.h>
+#include <node/kernel_notifications.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+using node::BlockManager;
+using node::KernelNotifications;
+
+static constexpr size_t NUM_HEADERS{100'000};
+
+/**
+ * Load a block tree database of headers-only entries, like the ones filling
+ * the block index while syncing headers, into a new block index.
+ */
+static void LoadBlockIndex(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<BasicTestingSetup>()};
+    auto& node{testing_setup->m_node};
+    KernelNotifications notifications{*Assert(node.shutdown), node.exit_status, *Assert(node.warnings)};
+    const BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .blocks_dir = testing_setup->m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+    };
+
+    LOCK(::cs_main);
+    std::unique_ptr<node::BlockTreeDB> block_tree_db;
+    {
+        BlockManager blockman{*Assert(node.shutdown), blockman_opts};
+        blockman.m_block_tree_db = std::make_unique<node::BlockTreeDB>(DBParams{
+            .path = testing_setup->m_args.GetDataDirNet() / "blocks" / "index",
+            .cache_bytes = 8 << 20,
+            .memory_only = true,
+        });
+        CBlockIndex* best_header{nullptr};
+        CBlockHeader header{Params().GenesisBlock().GetBlockHeader()};
+        blockman.AddToBlockIndex(header, best_header);
+        for (size_t i{0}; i < NUM_HEADERS; ++i) {
+            header.hashPrevBlock = header.GetHash();
+            header.nTime += 600;
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, Params().GetConsensus())) ++header.nNonce;
+            blockman.AddToBlockIndex(header, best_header);
+        }
+        const bool written{blockman.WriteBlockIndexDB()};
+        assert(written);
+        block_tree_db = std::move(blockman.m_block_tree_db);
+    }
+
+    bench.unit("header").batch(NUM_HEADERS + 1).run([&] {
+        BlockManager blockman{*Assert(node.shutdown), blockman_opts};
+        blockman.m_block_tree_db = std::move(block_tree_db);
+        const bool loaded{blockman.LoadBlockIndexDB(/*snapshot_blockhash=*/std::nullopt)};
+        assert(loaded);
+        assert(blockman.m_block_index.size() == NUM_HEADERS + 1);
+        block_tree_db = std::move(blockman.m_block_tree_db);
+    });
+}
+
+BENCHMARK(LoadBlockIndex, benchmark::PriorityLevel::HIGH);
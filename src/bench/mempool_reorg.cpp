@@ -0,0 +1,85 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <consensus/amount.h>
+#include <kernel/disconnected_transactions.h>
+#include <kernel/mempool_entry.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+//! Number of transaction chains in the mempool.
+static constexpr size_t NUM_CHAINS{200};
+//! Length of each chain, within the default ancestor and descendant limits.
+static constexpr size_t CHAIN_LENGTH{24};
+//! Number of transactions at the start of each chain that are in the block.
+static constexpr size_t NUM_MINED{12};
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, /*fee=*/1000, /*time=*/0, /*entry_height=*/1, /*entry_sequence=*/0,
+                                      /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+}
+
+/**
+ * Repeatedly connect and disconnect a block mining the first half of many
+ * transaction chains, the way validation updates the mempool through a reorg:
+ * transactions of the connected block are removed with removeForBlock, and
+ * those of the disconnected block are added back from a
+ * DisconnectedBlockTransactions before calling UpdateTransactionsFromBlock.
+ */
+static void MempoolReorg(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN);
+    CTxMemPool& pool = *testing_setup->m_node.mempool;
+    FastRandomContext det_rand{true};
+
+    std::vector<CTransactionRef> block;
+    std::vector<CTransactionRef> unmined;
+    for (size_t chain{0}; chain < NUM_CHAINS; ++chain) {
+        COutPoint prevout{Txid::FromUint256(det_rand.rand256()), 0};
+        for (size_t i{0}; i < CHAIN_LENGTH; ++i) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(prevout);
+            tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            const auto ptx{MakeTransactionRef(tx)};
+            (i < NUM_MINED ? block : unmined).push_back(ptx);
+            prevout = COutPoint{ptx->GetHash(), 0};
+        }
+    }
+
+    LOCK2(cs_main, pool.cs);
+    for (const auto& tx : block) AddTx(tx, pool);
+    for (const auto& tx : unmined) AddTx(tx, pool);
+
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        pool.removeForBlock(block, /*nBlockHeight=*/1);
+
+        DisconnectedBlockTransactions disconnectpool{MAX_DISCONNECTED_TX_POOL_BYTES};
+        assert(disconnectpool.AddTransactionsFromBlock(block).empty());
+        const auto queued{disconnectpool.take()};
+        std::vector<uint256> hashes;
+        hashes.reserve(queued.size());
+        for (auto it{queued.rbegin()}; it != queued.rend(); ++it) {
+            AddTx(*it, pool);
+            hashes.push_back((*it)->GetHash());
+        }
+        pool.UpdateTransactionsFromBlock(hashes);
+        assert(pool.size() == NUM_CHAINS * CHAIN_LENGTH);
+    });
+}
+
+BENCHMARK(MempoolReorg, benchmark::PriorityLevel::HIGH);
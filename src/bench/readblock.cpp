@@ -28,9 +28,9 @@ static FlatFilePos WriteBlockToDisk(ChainstateManager& chainman)
     return chainman.m_blockman.SaveBlockToDisk(block, 0);
 }
 
-static void ReadBlockFromDiskTest(benchmark::Bench& bench)
+static void ReadBlockFromDisk(benchmark::Bench& bench, bool obfuscate)
 {
-    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN, {.extra_args = {obfuscate ? "-blocksxor=1" : "-blocksxor=0"}})};
     ChainstateManager& chainman{*testing_setup->m_node.chainman};
 
     CBlock block;
@@ -42,6 +42,16 @@ static void ReadBlockFromDiskTest(benchmark::Bench& bench)
     });
 }
 
+static void ReadBlockFromDiskTest(benchmark::Bench& bench)
+{
+    ReadBlockFromDisk(bench, /*obfuscate=*/true);
+}
+
+static void ReadBlockFromDiskUnobfuscated(benchmark::Bench& bench)
+{
+    ReadBlockFromDisk(bench, /*obfuscate=*/false);
+}
+
 static void ReadRawBlockFromDiskTest(benchmark::Bench& bench)
 {
     const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
@@ -57,4 +67,5 @@ static void ReadRawBlockFromDiskTest(benchmark::Bench& bench)
 }
 
 BENCHMARK(ReadBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadBlockFromDiskUnobfuscated, benchmark::PriorityLevel::HIGH);
 BENCHMARK(ReadRawBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
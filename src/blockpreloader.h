@@ -0,0 +1,184 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKPRELOADER_H
+#define BITCOIN_BLOCKPRELOADER_H
+
+#include <coins.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/threadnames.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Background thread preparing the next block to be connected while the
+ * current one is being validated.
+ *
+ * Preload() hands the thread a job for a block, typically reading it from
+ * disk, running the context-free checks on it and then looking up its inputs
+ * in the chainstate database. Take() claims the result for the same block,
+ * interrupting the job: the job must then return as soon as it has a block,
+ * so that connecting it is never delayed by lookups ConnectBlock can do
+ * itself.
+ *
+ * There is only ever one block being prepared, and the caller connects the
+ * blocks it takes in order, so this does not change the order in which blocks
+ * are committed. A job may run concurrently with anything except the
+ * destruction of what it reads from; Cancel() waits for it to complete.
+ */
+class BlockPreloader
+{
+public:
+    struct Result {
+        std::shared_ptr<const CBlock> block;
+        //! The view the coins were read from, and the value of a counter of
+        //! the writes to it taken before the first read.
+        const CCoinsView* coins_view{nullptr};
+        uint64_t coins_view_writes{0};
+        //! Unspent coins spent by the block.
+        std::vector<std::pair<COutPoint, Coin>> coins;
+    };
+
+    using Job = std::function<void(Result& result, const std::atomic<bool>& interrupt)>;
+
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+
+    //! Block the current job is for, if any.
+    std::optional<uint256> m_hash GUARDED_BY(m_mutex);
+    //! Job waiting to be run by the thread.
+    Job m_job GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){false};
+    //! Whether the job for m_hash has completed, its result being in m_result.
+    bool m_done GUARDED_BY(m_mutex){false};
+    Result m_result GUARDED_BY(m_mutex);
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    std::atomic<bool> m_interrupt{false};
+
+    std::thread m_thread;
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        while (true) {
+            Job job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_request_stop || m_job; });
+                if (m_request_stop) return;
+                job = std::move(m_job);
+                m_job = nullptr;
+                m_running = true;
+            }
+            Result result;
+            job(result, m_interrupt);
+            {
+                LOCK(m_mutex);
+                m_result = std::move(result);
+                m_done = true;
+                m_running = false;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    //! Wait for the job in progress, if any, and forget about it.
+    void Reset(UniqueLock<Mutex>& lock) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        m_interrupt = true;
+        m_job = nullptr;
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_running; });
+        m_hash.reset();
+        m_done = false;
+        m_result = {};
+    }
+
+public:
+    //! Create a new block preloader, doing nothing unless enabled.
+    explicit BlockPreloader(bool enabled)
+    {
+        if (enabled) {
+            m_thread = std::thread([this]() {
+                util::ThreadRename("blockpreload");
+                Loop();
+            });
+        }
+    }
+
+    // Since this class manages its own thread, copy and move operations are not appropriate.
+    BlockPreloader(const BlockPreloader&) = delete;
+    BlockPreloader& operator=(const BlockPreloader&) = delete;
+    BlockPreloader(BlockPreloader&&) = delete;
+    BlockPreloader& operator=(BlockPreloader&&) = delete;
+
+    ~BlockPreloader()
+    {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            Reset(lock);
+            m_request_stop = true;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    bool IsEnabled() const { return m_thread.joinable(); }
+
+    /**
+     * Start preparing the block with the given hash, abandoning the block
+     * currently being prepared, if any.
+     */
+    void Preload(const uint256& hash, Job job) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (!IsEnabled()) return;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            if (m_hash == hash) return;
+            Reset(lock);
+            m_interrupt = false;
+            m_hash = hash;
+            m_job = std::move(job);
+        }
+        m_cv.notify_all();
+    }
+
+    /**
+     * Claim the result of the job for the block with the given hash,
+     * interrupting it and waiting for it to return if necessary. Returns
+     * std::nullopt if that block is not the one being prepared.
+     */
+    std::optional<Result> Take(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        if (m_hash != hash) return std::nullopt;
+        m_interrupt = true;
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_done; });
+        Result result{std::move(m_result)};
+        m_hash.reset();
+        m_done = false;
+        m_result = {};
+        return result;
+    }
+
+    //! Abandon the block being prepared, waiting for its job to return.
+    void Cancel() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        Reset(lock);
+    }
+};
+
+#endif // BITCOIN_BLOCKPRELOADER_H
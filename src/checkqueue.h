@@ -10,7 +10,12 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
 #include <iterator>
+#include <memory>
+#include <string>
 #include <vector>
 
 /**
@@ -22,12 +27,25 @@
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker (including the master) has its own deque of verifications,
+  * protected by its own mutex. Batches pushed by the master are spread over
+  * the workers' deques. A worker takes verifications from the back of its
+  * own deque and, once that is empty, steals half of the verifications
+  * queued at the front of another's. The shared mutex is only used for
+  * workers going to sleep and waking up, so it is not contended while there
+  * is work to do.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    struct WorkerQueue {
+        Mutex m_mutex;
+        std::deque<T> m_checks GUARDED_BY(m_mutex);
+    };
+
+    //! Mutex to protect the sleeping and waking up of workers
     Mutex m_mutex;
 
     //! Worker threads block on this when out of work
@@ -36,25 +54,29 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! One deque per worker thread, followed by the master's.
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! Index of the worker deque the next batch is pushed to. Only used by the master.
+    size_t m_next_queue{0};
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
-
-    //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    /**
+     * Number of verifications in the deques. Only increased while holding
+     * m_mutex, so that sleeping workers are not missed, and decreased by
+     * whoever takes verifications, after taking them, so it may be
+     * transiently negative.
+     */
+    std::atomic<int64_t> m_queued{0};
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes elements that are no longer queued, but still in a
+     * worker's own batch.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<int64_t> m_todo{0};
+
+    //! The temporary evaluation result.
+    std::atomic<bool> m_all_ok{true};
 
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
@@ -62,79 +84,101 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
+    /**
+     * Move a batch of verifications out of the deque at index. From the
+     * worker's own deque, take from the back and leave at least half of them
+     * for others to steal. From another's, steal half from the front.
+     */
+    bool Take(size_t index, bool own, std::vector<T>& checks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WorkerQueue& queue{*m_queues[index]};
+        LOCK(queue.m_mutex);
+        const size_t size{queue.m_checks.size()};
+        if (size == 0) return false;
+        const size_t count{std::max<size_t>(1, std::min<size_t>(nBatchSize, own ? size / 2 : (size + 1) / 2))};
+        if (own) {
+            const auto start_it{queue.m_checks.end() - count};
+            checks.assign(std::make_move_iterator(start_it), std::make_move_iterator(queue.m_checks.end()));
+            queue.m_checks.erase(start_it, queue.m_checks.end());
+        } else {
+            const auto end_it{queue.m_checks.begin() + count};
+            checks.assign(std::make_move_iterator(queue.m_checks.begin()), std::make_move_iterator(end_it));
+            queue.m_checks.erase(queue.m_checks.begin(), end_it);
+        }
+        m_queued.fetch_sub(count, std::memory_order_relaxed);
+        return true;
+    }
+
+    //! Take a batch from the worker's own deque, or steal one from another's.
+    bool TakeOrSteal(size_t self, std::vector<T>& checks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (Take(self, /*own=*/true, checks)) return true;
+        for (size_t i{1}; i < m_queues.size(); ++i) {
+            if (Take((self + i) % m_queues.size(), /*own=*/false, checks)) return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    bool Loop(size_t self, bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                if (m_request_stop) {
-                    return false;
+        while (true) {
+            if (TakeOrSteal(self, vChecks)) {
+                // Skip the remaining verifications once one failed.
+                bool fOk = m_all_ok.load(std::memory_order_relaxed);
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                if (!fOk) m_all_ok.store(false, std::memory_order_relaxed);
+                const size_t nNow{vChecks.size()};
+                // Destroy the verifications before reporting them as completed.
+                vChecks.clear();
+                if (m_todo.fetch_sub(nNow, std::memory_order_acq_rel) == int64_t(nNow) && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    LOCK(m_mutex);
+                    m_master_cv.notify_one();
                 }
+                continue;
+            }
 
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                auto start_it = queue.end() - nNow;
-                vChecks.assign(std::make_move_iterator(start_it), std::make_move_iterator(queue.end()));
-                queue.erase(start_it, queue.end());
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+            WAIT_LOCK(m_mutex, lock);
+            if (m_request_stop) return false;
+            if (fMaster) {
+                m_master_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_request_stop || m_queued.load(std::memory_order_relaxed) > 0 || m_todo.load(std::memory_order_acquire) == 0;
+                });
+                if (m_request_stop) return false;
+                if (m_queued.load(std::memory_order_relaxed) <= 0 && m_todo.load(std::memory_order_acquire) == 0) {
+                    // return the current status, and reset it for new work later
+                    return m_all_ok.exchange(true, std::memory_order_relaxed);
+                }
+            } else {
+                m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_request_stop || m_queued.load(std::memory_order_relaxed) > 0;
+                });
+                if (m_request_stop) return false;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        }
     }
 
 public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     Mutex m_control_mutex;
 
-    //! Create a new check queue
-    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num)
+    //! Create a new check queue, whose worker threads are named after thread_name
+    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num, std::string thread_name = "scriptch")
         : nBatchSize(batch_size)
     {
+        for (int n = 0; n <= worker_threads_num; ++n) {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
         m_worker_threads.reserve(worker_threads_num);
         for (int n = 0; n < worker_threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                Loop(n, false /* worker thread */);
             });
         }
     }
@@ -149,7 +193,7 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        return Loop(true /* master thread */);
+        return Loop(m_worker_threads.size(), true /* master thread */);
     }
 
     //! Add a batch of checks to the queue
@@ -159,13 +203,21 @@ public:
             return;
         }
 
+        const size_t count{vChecks.size()};
+        // Count the checks before they can be taken, so that m_todo cannot drop to zero early.
+        m_todo.fetch_add(count, std::memory_order_relaxed);
+        // Spread batches over the workers' deques; the master's is only used if there are no workers.
+        WorkerQueue& queue{*m_queues[m_worker_threads.empty() ? 0 : m_next_queue++ % m_worker_threads.size()]};
+        {
+            LOCK(queue.m_mutex);
+            queue.m_checks.insert(queue.m_checks.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
+        }
         {
             LOCK(m_mutex);
-            queue.insert(queue.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
-            nTodo += vChecks.size();
+            m_queued.fetch_add(count, std::memory_order_relaxed);
         }
 
-        if (vChecks.size() == 1) {
+        if (count == 1) {
             m_worker_cv.notify_one();
         } else {
             m_worker_cv.notify_all();
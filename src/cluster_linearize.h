@@ -12,6 +12,7 @@
 #include <vector>
 #include <utility>
 
+#include <checkqueue.h>
 #include <random.h>
 #include <span.h>
 #include <util/feefrac.h>
@@ -1277,6 +1278,71 @@ std::vector<ClusterIndex> MergeLinearizations(const DepGraph<SetType>& depgraph,
     return ret;
 }
 
+/** A Linearize() and PostLinearize() run for one cluster, to be executed on a CCheckQueue. */
+template<typename SetType>
+class LinearizationJob
+{
+    const DepGraph<SetType>* m_depgraph;
+    Span<const ClusterIndex> m_old_linearization;
+    uint64_t m_max_iterations;
+    uint64_t m_rng_seed;
+    std::pair<std::vector<ClusterIndex>, bool>* m_result;
+
+public:
+    LinearizationJob(const DepGraph<SetType>& depgraph, Span<const ClusterIndex> old_linearization, uint64_t max_iterations,
+                     uint64_t rng_seed, std::pair<std::vector<ClusterIndex>, bool>& result) noexcept
+        : m_depgraph{&depgraph}, m_old_linearization{old_linearization}, m_max_iterations{max_iterations},
+          m_rng_seed{rng_seed}, m_result{&result} {}
+
+    bool operator()() noexcept
+    {
+        *m_result = Linearize(*m_depgraph, m_max_iterations, m_rng_seed, m_old_linearization);
+        PostLinearize(*m_depgraph, m_result->first);
+        return true;
+    }
+};
+
+/** Linearize many independent clusters, concurrently if a worker queue is given.
+ *
+ * @param[in] depgraphs           Dependency graphs of the clusters to linearize.
+ * @param[in] old_linearizations  Either empty, or an existing linearization (possibly empty) for
+ *                                each cluster, which the corresponding result will be at least as
+ *                                good as.
+ * @param[in] max_iterations      Iteration budget shared by all clusters, each of which gets an
+ *                                equal part of it.
+ * @param[in] rng_seed            A random number seed, from which one is derived per cluster.
+ * @param[in] queue               Worker queue to run the linearizations on, or nullptr to run them
+ *                                all in the calling thread.
+ * @return                        For each cluster, the result of Linearize() followed by
+ *                                PostLinearize().
+ */
+template<typename SetType>
+std::vector<std::pair<std::vector<ClusterIndex>, bool>> LinearizeClusters(
+    Span<const DepGraph<SetType>> depgraphs, Span<const std::vector<ClusterIndex>> old_linearizations,
+    uint64_t max_iterations, uint64_t rng_seed, CCheckQueue<LinearizationJob<SetType>>* queue) noexcept
+{
+    Assume(old_linearizations.empty() || old_linearizations.size() == depgraphs.size());
+    std::vector<std::pair<std::vector<ClusterIndex>, bool>> results(depgraphs.size());
+    if (depgraphs.empty()) return results;
+
+    const uint64_t max_iterations_each{max_iterations / depgraphs.size()};
+    InsecureRandomContext rng(rng_seed);
+    std::vector<LinearizationJob<SetType>> jobs;
+    jobs.reserve(depgraphs.size());
+    for (size_t i = 0; i < depgraphs.size(); ++i) {
+        const Span<const ClusterIndex> old_linearization{old_linearizations.empty() ? Span<const ClusterIndex>{} : Span{old_linearizations[i]}};
+        jobs.emplace_back(depgraphs[i], old_linearization, max_iterations_each, rng.rand64(), results[i]);
+    }
+    if (queue) {
+        CCheckQueueControl<LinearizationJob<SetType>> control(queue);
+        control.Add(std::move(jobs));
+        control.Wait();
+    } else {
+        for (auto& job : jobs) job();
+    }
+    return results;
+}
+
 } // namespace cluster_linearize
 
 #endif // BITCOIN_CLUSTER_LINEARIZE_H
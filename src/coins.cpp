@@ -31,51 +31,118 @@ bool CCoinsViewBacked::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &h
 std::unique_ptr<CCoinsViewCursor> CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn, bool deterministic) :
-    CCoinsViewBacked(baseIn), m_deterministic(deterministic),
-    cacheCoins(0, SaltedOutpointHasher(/*deterministic=*/deterministic), CCoinsMap::key_equal{}, &m_cache_coins_memory_resource)
+//! Chunk size of the memory resource of a single-shard cache. Shards of a sharded cache split it evenly.
+static constexpr size_t CACHE_CHUNK_SIZE_BYTES{262144};
+
+CoinsCacheShard::CoinsCacheShard(size_t chunk_size_bytes, bool deterministic) :
+    m_resource{chunk_size_bytes},
+    m_map{0, SaltedOutpointHasher{deterministic}, CCoinsMap::key_equal{}, &m_resource}
 {
     m_sentinel.second.SelfRef(m_sentinel);
 }
 
+void CoinsCacheShard::Reallocate(bool deterministic)
+{
+    // Shard should be empty when we're calling this.
+    assert(m_map.size() == 0);
+    const size_t chunk_size_bytes{m_resource.ChunkSizeBytes()};
+    m_map.~CCoinsMap();
+    m_resource.~CCoinsMapMemoryResource();
+    ::new (&m_resource) CCoinsMapMemoryResource{chunk_size_bytes};
+    ::new (&m_map) CCoinsMap{0, SaltedOutpointHasher{deterministic}, CCoinsMap::key_equal{}, &m_resource};
+}
+
+CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn, bool deterministic, size_t num_shards) :
+    CCoinsViewBacked(baseIn), m_deterministic(deterministic), m_shard_hasher(deterministic)
+{
+    assert(num_shards > 0);
+    m_shards.reserve(num_shards);
+    for (size_t i{0}; i < num_shards; ++i) {
+        m_shards.push_back(std::make_unique<CoinsCacheShard>(CACHE_CHUNK_SIZE_BYTES / num_shards, deterministic));
+    }
+}
+
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    size_t usage{0};
+    for (const auto& shard : m_shards) {
+        usage += memusage::DynamicUsage(shard->m_map) + shard->m_usage;
+    }
+    return usage;
 }
 
-CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
-    const auto [ret, inserted] = cacheCoins.try_emplace(outpoint);
+CCoinsMap::iterator CCoinsViewCache::FetchCoin(CoinsCacheShard& shard, const COutPoint &outpoint) const {
+    if (ConcurrentReads()) {
+        // Do not expose an empty entry to concurrent readers while the coin is being read from the base.
+        // Concurrent readers do not use the recency list, so it can be updated without a lock.
+        if (auto it{shard.m_map.find(outpoint)}; it != shard.m_map.end()) {
+            it->second.Touch(*it, shard.m_sentinel);
+            return it;
+        }
+        Coin coin;
+        if (!base->GetCoin(outpoint, coin)) return shard.m_map.end();
+        const auto lock{WriteLock(shard)};
+        const auto ret{shard.m_map.try_emplace(outpoint, std::move(coin)).first};
+        ret->second.Touch(*ret, shard.m_sentinel);
+        if (ret->second.coin.IsSpent()) {
+            // The parent only has an empty entry for this outpoint; we can consider our version as fresh.
+            ret->second.AddFlags(CCoinsCacheEntry::FRESH, *ret, shard.m_sentinel);
+        }
+        shard.m_usage += ret->second.coin.DynamicMemoryUsage();
+        return ret;
+    }
+    const auto [ret, inserted] = shard.m_map.try_emplace(outpoint);
     if (inserted) {
         if (!base->GetCoin(outpoint, ret->second.coin)) {
-            cacheCoins.erase(ret);
-            return cacheCoins.end();
+            shard.m_map.erase(ret);
+            return shard.m_map.end();
         }
         if (ret->second.coin.IsSpent()) {
             // The parent only has an empty entry for this outpoint; we can consider our version as fresh.
-            ret->second.AddFlags(CCoinsCacheEntry::FRESH, *ret, m_sentinel);
+            ret->second.AddFlags(CCoinsCacheEntry::FRESH, *ret, shard.m_sentinel);
         }
-        cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
+        shard.m_usage += ret->second.coin.DynamicMemoryUsage();
     }
+    ret->second.Touch(*ret, shard.m_sentinel);
     return ret;
 }
 
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
-    CCoinsMap::const_iterator it = FetchCoin(outpoint);
-    if (it != cacheCoins.end()) {
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    CCoinsMap::const_iterator it = FetchCoin(shard, outpoint);
+    if (it != shard.m_map.end()) {
         coin = it->second.coin;
         return !coin.IsSpent();
     }
     return false;
 }
 
+std::optional<Coin> CCoinsViewCache::PeekCoin(const COutPoint& outpoint) const
+{
+    const CoinsCacheShard& shard{GetShard(outpoint)};
+    {
+        std::shared_lock<std::shared_mutex> lock;
+        if (ConcurrentReads()) lock = std::shared_lock{shard.m_mutex};
+        if (const auto it{shard.m_map.find(outpoint)}; it != shard.m_map.end()) {
+            if (it->second.coin.IsSpent()) return std::nullopt;
+            return it->second.coin;
+        }
+    }
+    Coin coin;
+    if (!base->GetCoin(outpoint, coin) || coin.IsSpent()) return std::nullopt;
+    return coin;
+}
+
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    const auto lock{WriteLock(shard)};
     CCoinsMap::iterator it;
     bool inserted;
-    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    std::tie(it, inserted) = shard.m_map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
     bool fresh = false;
     if (!inserted) {
-        cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+        shard.m_usage -= it->second.coin.DynamicMemoryUsage();
     }
     if (!possible_overwrite) {
         if (!it->second.coin.IsSpent()) {
@@ -97,8 +164,9 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
         fresh = !it->second.IsDirty();
     }
     it->second.coin = std::move(coin);
-    it->second.AddFlags(CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0), *it, m_sentinel);
-    cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    it->second.AddFlags(CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0), *it, shard.m_sentinel);
+    it->second.Touch(*it, shard.m_sentinel);
+    shard.m_usage += it->second.coin.DynamicMemoryUsage();
     TRACE5(utxocache, add,
            outpoint.hash.data(),
            (uint32_t)outpoint.n,
@@ -108,16 +176,32 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
 }
 
 void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin) {
-    cachedCoinsUsage += coin.DynamicMemoryUsage();
-    auto [it, inserted] = cacheCoins.emplace(
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    const auto lock{WriteLock(shard)};
+    shard.m_usage += coin.DynamicMemoryUsage();
+    auto [it, inserted] = shard.m_map.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(std::move(outpoint)),
         std::forward_as_tuple(std::move(coin)));
     if (inserted) {
-        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, m_sentinel);
+        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, shard.m_sentinel);
+        it->second.Touch(*it, shard.m_sentinel);
     }
 }
 
+bool CCoinsViewCache::EmplaceCoinFromBase(const COutPoint& outpoint, Coin&& coin)
+{
+    Assume(!coin.IsSpent());
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    const auto lock{WriteLock(shard)};
+    const auto [it, inserted] = shard.m_map.try_emplace(outpoint, std::move(coin));
+    if (inserted) {
+        it->second.Touch(*it, shard.m_sentinel);
+        shard.m_usage += it->second.coin.DynamicMemoryUsage();
+    }
+    return inserted;
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check_for_overwrite) {
     bool fCoinbase = tx.IsCoinBase();
     const Txid& txid = tx.GetHash();
@@ -130,9 +214,11 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool
 }
 
 bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
-    CCoinsMap::iterator it = FetchCoin(outpoint);
-    if (it == cacheCoins.end()) return false;
-    cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    CCoinsMap::iterator it = FetchCoin(shard, outpoint);
+    if (it == shard.m_map.end()) return false;
+    const auto lock{WriteLock(shard)};
+    shard.m_usage -= it->second.coin.DynamicMemoryUsage();
     TRACE5(utxocache, spent,
            outpoint.hash.data(),
            (uint32_t)outpoint.n,
@@ -143,9 +229,9 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
         *moveout = std::move(it->second.coin);
     }
     if (it->second.IsFresh()) {
-        cacheCoins.erase(it);
+        shard.m_map.erase(it);
     } else {
-        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, m_sentinel);
+        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, shard.m_sentinel);
         it->second.coin.Clear();
     }
     return true;
@@ -154,8 +240,9 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
 static const Coin coinEmpty;
 
 const Coin& CCoinsViewCache::AccessCoin(const COutPoint &outpoint) const {
-    CCoinsMap::const_iterator it = FetchCoin(outpoint);
-    if (it == cacheCoins.end()) {
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    CCoinsMap::const_iterator it = FetchCoin(shard, outpoint);
+    if (it == shard.m_map.end()) {
         return coinEmpty;
     } else {
         return it->second.coin;
@@ -163,13 +250,15 @@ const Coin& CCoinsViewCache::AccessCoin(const COutPoint &outpoint) const {
 }
 
 bool CCoinsViewCache::HaveCoin(const COutPoint &outpoint) const {
-    CCoinsMap::const_iterator it = FetchCoin(outpoint);
-    return (it != cacheCoins.end() && !it->second.coin.IsSpent());
+    CoinsCacheShard& shard{GetShard(outpoint)};
+    CCoinsMap::const_iterator it = FetchCoin(shard, outpoint);
+    return (it != shard.m_map.end() && !it->second.coin.IsSpent());
 }
 
 bool CCoinsViewCache::HaveCoinInCache(const COutPoint &outpoint) const {
-    CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
-    return (it != cacheCoins.end() && !it->second.coin.IsSpent());
+    const CoinsCacheShard& shard{GetShard(outpoint)};
+    CCoinsMap::const_iterator it = shard.m_map.find(outpoint);
+    return (it != shard.m_map.end() && !it->second.coin.IsSpent());
 }
 
 uint256 CCoinsViewCache::GetBestBlock() const {
@@ -188,14 +277,16 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
         if (!it->second.IsDirty()) {
             continue;
         }
-        CCoinsMap::iterator itUs = cacheCoins.find(it->first);
-        if (itUs == cacheCoins.end()) {
+        CoinsCacheShard& shard{GetShard(it->first)};
+        const auto lock{WriteLock(shard)};
+        CCoinsMap::iterator itUs = shard.m_map.find(it->first);
+        if (itUs == shard.m_map.end()) {
             // The parent cache does not have an entry, while the child cache does.
             // We can ignore it if it's both spent and FRESH in the child
             if (!(it->second.IsFresh() && it->second.coin.IsSpent())) {
                 // Create the coin in the parent cache, move the data up
                 // and mark it as dirty.
-                itUs = cacheCoins.try_emplace(it->first).first;
+                itUs = shard.m_map.try_emplace(it->first).first;
                 CCoinsCacheEntry& entry{itUs->second};
                 if (cursor.WillErase(*it)) {
                     // Since this entry will be erased,
@@ -204,13 +295,14 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
                 } else {
                     entry.coin = it->second.coin;
                 }
-                cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
-                entry.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, m_sentinel);
+                shard.m_usage += entry.coin.DynamicMemoryUsage();
+                entry.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, shard.m_sentinel);
+                entry.Touch(*itUs, shard.m_sentinel);
                 // We can mark it FRESH in the parent if it was FRESH in the child
                 // Otherwise it might have just been flushed from the parent's cache
                 // and already exist in the grandparent
                 if (it->second.IsFresh()) {
-                    entry.AddFlags(CCoinsCacheEntry::FRESH, *itUs, m_sentinel);
+                    entry.AddFlags(CCoinsCacheEntry::FRESH, *itUs, shard.m_sentinel);
                 }
             }
         } else {
@@ -226,11 +318,11 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
             if (itUs->second.IsFresh() && it->second.coin.IsSpent()) {
                 // The grandparent cache does not have an entry, and the coin
                 // has been spent. We can just delete it from the parent cache.
-                cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
-                cacheCoins.erase(itUs);
+                shard.m_usage -= itUs->second.coin.DynamicMemoryUsage();
+                shard.m_map.erase(itUs);
             } else {
                 // A normal modification.
-                cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
+                shard.m_usage -= itUs->second.coin.DynamicMemoryUsage();
                 if (cursor.WillErase(*it)) {
                     // Since this entry will be erased,
                     // we can move the coin into us instead of copying it
@@ -238,8 +330,9 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
                 } else {
                     itUs->second.coin = it->second.coin;
                 }
-                cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
-                itUs->second.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, m_sentinel);
+                shard.m_usage += itUs->second.coin.DynamicMemoryUsage();
+                itUs->second.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, shard.m_sentinel);
+                itUs->second.Touch(*itUs, shard.m_sentinel);
                 // NOTE: It isn't safe to mark the coin as FRESH in the parent
                 // cache. If it already existed and was spent in the parent
                 // cache then marking it FRESH would prevent that spentness
@@ -251,47 +344,94 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
     return true;
 }
 
+CoinsViewCacheCursor CCoinsViewCache::FlaggedCursor(bool will_erase) const
+{
+    return CoinsViewCacheCursor{m_shards, will_erase, /*lock=*/ConcurrentReads()};
+}
+
 bool CCoinsViewCache::Flush() {
-    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/true)};
+    auto cursor{FlaggedCursor(/*will_erase=*/true)};
     bool fOk = base->BatchWrite(cursor, hashBlock);
     if (fOk) {
-        cacheCoins.clear();
+        for (auto& shard : m_shards) {
+            const auto lock{WriteLock(*shard)};
+            shard->m_map.clear();
+        }
         ReallocateCache();
     }
-    cachedCoinsUsage = 0;
+    for (auto& shard : m_shards) {
+        shard->m_usage = 0;
+    }
     return fOk;
 }
 
 bool CCoinsViewCache::Sync()
 {
-    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/false)};
+    auto cursor{FlaggedCursor(/*will_erase=*/false)};
     bool fOk = base->BatchWrite(cursor, hashBlock);
     if (fOk) {
-        if (m_sentinel.second.Next() != &m_sentinel) {
-            /* BatchWrite must clear flags of all entries */
-            throw std::logic_error("Not all unspent flagged entries were cleared");
+        for (const auto& shard : m_shards) {
+            if (shard->m_sentinel.second.Next() != &shard->m_sentinel) {
+                /* BatchWrite must clear flags of all entries */
+                throw std::logic_error("Not all unspent flagged entries were cleared");
+            }
         }
     }
     return fOk;
 }
 
+bool CCoinsViewCache::SyncAndEvict(size_t max_usage)
+{
+    if (!Sync()) return false;
+    const size_t max_shard_usage{max_usage / m_shards.size()};
+    for (auto& shard : m_shards) {
+        const auto lock{WriteLock(*shard)};
+        // All entries are unflagged now, so any of them can be erased.
+        const auto shard_usage{[&] {
+            return memusage::DynamicUsage(shard->m_map) + shard->m_usage - shard->m_resource.NumFreeListBytes();
+        }};
+        for (CoinsCachePair* lru{shard->m_sentinel.second.MoreRecent()};
+             lru != &shard->m_sentinel && shard_usage() > max_shard_usage;
+             lru = shard->m_sentinel.second.MoreRecent()) {
+            shard->m_usage -= lru->second.coin.DynamicMemoryUsage();
+            shard->m_map.erase(lru->first);
+        }
+    }
+    return true;
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
-    CCoinsMap::iterator it = cacheCoins.find(hash);
-    if (it != cacheCoins.end() && !it->second.IsDirty() && !it->second.IsFresh()) {
-        cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+    CoinsCacheShard& shard{GetShard(hash)};
+    CCoinsMap::iterator it = shard.m_map.find(hash);
+    if (it != shard.m_map.end() && !it->second.IsDirty() && !it->second.IsFresh()) {
+        shard.m_usage -= it->second.coin.DynamicMemoryUsage();
         TRACE5(utxocache, uncache,
                hash.hash.data(),
                (uint32_t)hash.n,
                (uint32_t)it->second.coin.nHeight,
                (int64_t)it->second.coin.out.nValue,
                (bool)it->second.coin.IsCoinBase());
-        cacheCoins.erase(it);
+        const auto lock{WriteLock(shard)};
+        shard.m_map.erase(it);
+    }
+}
+
+size_t CCoinsViewCache::ReusableMemoryUsage() const
+{
+    size_t usage{0};
+    for (const auto& shard : m_shards) {
+        usage += shard->m_resource.NumFreeListBytes();
     }
+    return usage;
 }
 
 unsigned int CCoinsViewCache::GetCacheSize() const {
-    return cacheCoins.size();
+    size_t size{0};
+    for (const auto& shard : m_shards) {
+        size += shard->m_map.size();
+    }
+    return size;
 }
 
 bool CCoinsViewCache::HaveInputs(const CTransaction& tx) const
@@ -308,45 +448,58 @@ bool CCoinsViewCache::HaveInputs(const CTransaction& tx) const
 
 void CCoinsViewCache::ReallocateCache()
 {
-    // Cache should be empty when we're calling this.
-    assert(cacheCoins.size() == 0);
-    cacheCoins.~CCoinsMap();
-    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
-    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource{};
-    ::new (&cacheCoins) CCoinsMap{0, SaltedOutpointHasher{/*deterministic=*/m_deterministic}, CCoinsMap::key_equal{}, &m_cache_coins_memory_resource};
+    for (auto& shard : m_shards) {
+        const auto lock{WriteLock(*shard)};
+        shard->Reallocate(m_deterministic);
+    }
 }
 
 void CCoinsViewCache::SanityCheck() const
 {
-    size_t recomputed_usage = 0;
-    size_t count_flagged = 0;
-    for (const auto& [_, entry] : cacheCoins) {
-        unsigned attr = 0;
-        if (entry.IsDirty()) attr |= 1;
-        if (entry.IsFresh()) attr |= 2;
-        if (entry.coin.IsSpent()) attr |= 4;
-        // Only 5 combinations are possible.
-        assert(attr != 2 && attr != 4 && attr != 7);
-
-        // Recompute cachedCoinsUsage.
-        recomputed_usage += entry.coin.DynamicMemoryUsage();
-
-        // Count the number of entries we expect in the linked list.
-        if (entry.IsDirty() || entry.IsFresh()) ++count_flagged;
-    }
-    // Iterate over the linked list of flagged entries.
-    size_t count_linked = 0;
-    for (auto it = m_sentinel.second.Next(); it != &m_sentinel; it = it->second.Next()) {
-        // Verify linked list integrity.
-        assert(it->second.Next()->second.Prev() == it);
-        assert(it->second.Prev()->second.Next() == it);
-        // Verify they are actually flagged.
-        assert(it->second.IsDirty() || it->second.IsFresh());
-        // Count the number of entries actually in the list.
-        ++count_linked;
+    for (const auto& shard : m_shards) {
+        size_t recomputed_usage = 0;
+        size_t count_flagged = 0;
+        for (const auto& [outpoint, entry] : shard->m_map) {
+            unsigned attr = 0;
+            if (entry.IsDirty()) attr |= 1;
+            if (entry.IsFresh()) attr |= 2;
+            if (entry.coin.IsSpent()) attr |= 4;
+            // Only 5 combinations are possible.
+            assert(attr != 2 && attr != 4 && attr != 7);
+
+            // Verify the entry is in the right shard.
+            assert(&GetShard(outpoint) == shard.get());
+
+            // Recompute the shard's cached usage.
+            recomputed_usage += entry.coin.DynamicMemoryUsage();
+
+            // Count the number of entries we expect in the linked list.
+            if (entry.IsDirty() || entry.IsFresh()) ++count_flagged;
+        }
+        // Iterate over the linked list of flagged entries.
+        size_t count_linked = 0;
+        for (auto it = shard->m_sentinel.second.Next(); it != &shard->m_sentinel; it = it->second.Next()) {
+            // Verify linked list integrity.
+            assert(it->second.Next()->second.Prev() == it);
+            assert(it->second.Prev()->second.Next() == it);
+            // Verify they are actually flagged.
+            assert(it->second.IsDirty() || it->second.IsFresh());
+            // Count the number of entries actually in the list.
+            ++count_linked;
+        }
+        assert(count_linked == count_flagged);
+        assert(recomputed_usage == shard->m_usage);
+        // Iterate over the recency list. Entries inserted into the map directly
+        // rather than through the cache are not in it.
+        size_t count_recent = 0;
+        for (auto it = shard->m_sentinel.second.MoreRecent(); it != &shard->m_sentinel; it = it->second.MoreRecent()) {
+            assert(it->second.MoreRecent()->second.LessRecent() == it);
+            assert(it->second.LessRecent()->second.MoreRecent() == it);
+            assert(&*shard->m_map.find(it->first) == it);
+            ++count_recent;
+        }
+        assert(count_recent <= shard->m_map.size());
     }
-    assert(count_linked == count_flagged);
-    assert(recomputed_usage == cachedCoinsUsage);
 }
 
 static const size_t MIN_TRANSACTION_OUTPUT_WEIGHT = WITNESS_SCALE_FACTOR * ::GetSerializeSize(CTxOut());
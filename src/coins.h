@@ -20,7 +20,12 @@
 #include <stdint.h>
 
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
 /**
  * A UTXO entry.
@@ -126,6 +131,15 @@ private:
      */
     CoinsCachePair* m_prev{nullptr};
     CoinsCachePair* m_next{nullptr};
+    /**
+     * These are used to create a doubly linked list of all entries of a map,
+     * flagged or not, from the least to the most recently used one. They are
+     * set in Touch and unset when the entry is destroyed. The list shares its
+     * sentinel with the flagged entry list, and lets a cache evict the entries
+     * it used longest ago.
+     */
+    CoinsCachePair* m_lru_prev{nullptr};
+    CoinsCachePair* m_lru_next{nullptr};
     uint8_t m_flags{0};
 
 public:
@@ -157,6 +171,10 @@ public:
     ~CCoinsCacheEntry()
     {
         ClearFlags();
+        if (m_lru_next) {
+            m_lru_next->second.m_lru_prev = m_lru_prev;
+            m_lru_prev->second.m_lru_next = m_lru_next;
+        }
     }
 
     //! Adding a flag also requires a self reference to the pair that contains
@@ -180,6 +198,24 @@ public:
         m_prev->second.m_next = m_next;
         m_flags = 0;
     }
+    //! Mark this entry as the most recently used one of the recency list
+    //! ending at sentinel, adding it to that list if needed.
+    inline void Touch(CoinsCachePair& self, CoinsCachePair& sentinel) noexcept
+    {
+        Assume(&self.second == this);
+        if (m_lru_next == &sentinel) return;
+        if (m_lru_next) {
+            m_lru_next->second.m_lru_prev = m_lru_prev;
+            m_lru_prev->second.m_lru_next = m_lru_next;
+        }
+        m_lru_prev = sentinel.second.m_lru_prev;
+        m_lru_next = &sentinel;
+        sentinel.second.m_lru_prev = &self;
+        m_lru_prev->second.m_lru_next = &self;
+    }
+    //! Neighbours in the recency list. The entry after the sentinel is the least recently used one.
+    inline CoinsCachePair* MoreRecent() const noexcept { return m_lru_next; }
+    inline CoinsCachePair* LessRecent() const noexcept { return m_lru_prev; }
     inline uint8_t GetFlags() const noexcept { return m_flags; }
     inline bool IsDirty() const noexcept { return m_flags & DIRTY; }
     inline bool IsFresh() const noexcept { return m_flags & FRESH; }
@@ -202,6 +238,8 @@ public:
         Assume(&self.second == this);
         m_prev = &self;
         m_next = &self;
+        m_lru_prev = &self;
+        m_lru_next = &self;
         // Set sentinel to DIRTY so we can call Next on it
         m_flags = DIRTY;
     }
@@ -224,6 +262,35 @@ using CCoinsMap = std::unordered_map<COutPoint,
 
 using CCoinsMapMemoryResource = CCoinsMap::allocator_type::ResourceType;
 
+/**
+ * One hash partition of a CCoinsViewCache.
+ *
+ * Each shard has its own map, pool allocator and slice of the flagged entry
+ * linked list, so that a modification only ever touches a single shard.
+ */
+struct CoinsCacheShard
+{
+    CCoinsMapMemoryResource m_resource;
+    /* The starting sentinel of this shard's flagged entry circular doubly linked list. */
+    CoinsCachePair m_sentinel;
+    CCoinsMap m_map;
+    /* Cached dynamic memory usage for the inner Coin objects of this shard. */
+    size_t m_usage{0};
+    /**
+     * Taken exclusively by the owner of the cache while it modifies this shard,
+     * and shared by other threads reading it through CCoinsViewCache::PeekCoin.
+     * Only used by caches which support concurrent reads.
+     */
+    mutable std::shared_mutex m_mutex;
+
+    CoinsCacheShard(size_t chunk_size_bytes, bool deterministic);
+    CoinsCacheShard(const CoinsCacheShard&) = delete;
+    CoinsCacheShard& operator=(const CoinsCacheShard&) = delete;
+
+    //! Recreate the (empty) map and its memory resource, releasing all memory held by them.
+    void Reallocate(bool deterministic);
+};
+
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
 {
@@ -255,6 +322,9 @@ private:
  * caller will erase the entry after BatchWrite returns. If so, the receiver can
  * perform optimizations such as moving the coin out of the CCoinsCachEntry instead
  * of copying it.
+ *
+ * For a sharded cache, the flagged entries of all shards are visited one shard
+ * after the other, so End() does not correspond to any sentinel.
  */
 struct CoinsViewCacheCursor
 {
@@ -268,11 +338,28 @@ struct CoinsViewCacheCursor
     CoinsViewCacheCursor(size_t& usage LIFETIMEBOUND,
                         CoinsCachePair& sentinel LIFETIMEBOUND,
                         CCoinsMap& map LIFETIMEBOUND,
-                        bool will_erase) noexcept
-        : m_usage(usage), m_sentinel(sentinel), m_map(map), m_will_erase(will_erase) {}
+                        bool will_erase)
+        : m_slices{{&usage, &sentinel, &map, nullptr}}, m_will_erase(will_erase) {}
+
+    //! Iterate over the flagged entries of all the given shards. If lock is set, the
+    //! shard's mutex is taken while erasing from its map.
+    CoinsViewCacheCursor(const std::vector<std::unique_ptr<CoinsCacheShard>>& shards LIFETIMEBOUND,
+                         bool will_erase,
+                         bool lock)
+        : m_will_erase(will_erase)
+    {
+        m_slices.reserve(shards.size());
+        for (const auto& shard : shards) {
+            m_slices.push_back({&shard->m_usage, &shard->m_sentinel, &shard->m_map, lock ? &shard->m_mutex : nullptr});
+        }
+    }
 
-    inline CoinsCachePair* Begin() const noexcept { return m_sentinel.second.Next(); }
-    inline CoinsCachePair* End() const noexcept { return &m_sentinel; }
+    inline CoinsCachePair* Begin() noexcept
+    {
+        m_current = 0;
+        return SkipEmpty(m_slices[0].sentinel->second.Next());
+    }
+    inline CoinsCachePair* End() const noexcept { return nullptr; }
 
     //! Return the next entry after current, possibly erasing current
     inline CoinsCachePair* NextAndMaybeErase(CoinsCachePair& current) noexcept
@@ -282,20 +369,39 @@ struct CoinsViewCacheCursor
         // Otherwise clear the flags on the entry.
         if (!m_will_erase) {
             if (current.second.coin.IsSpent()) {
-                m_usage -= current.second.coin.DynamicMemoryUsage();
-                m_map.erase(current.first);
+                Slice& slice{m_slices[m_current]};
+                *slice.usage -= current.second.coin.DynamicMemoryUsage();
+                std::unique_lock<std::shared_mutex> lock;
+                if (slice.mutex) lock = std::unique_lock{*slice.mutex};
+                slice.map->erase(current.first);
             } else {
                 current.second.ClearFlags();
             }
         }
-        return next_entry;
+        return SkipEmpty(next_entry);
     }
 
     inline bool WillErase(CoinsCachePair& current) const noexcept { return m_will_erase || current.second.coin.IsSpent(); }
 private:
-    size_t& m_usage;
-    CoinsCachePair& m_sentinel;
-    CCoinsMap& m_map;
+    struct Slice {
+        size_t* usage;
+        CoinsCachePair* sentinel;
+        CCoinsMap* map;
+        std::shared_mutex* mutex;
+    };
+
+    //! Advance past the end of the current slice's linked list to the first entry of the next non-empty slice.
+    inline CoinsCachePair* SkipEmpty(CoinsCachePair* entry) noexcept
+    {
+        while (entry == m_slices[m_current].sentinel) {
+            if (++m_current == m_slices.size()) return End();
+            entry = m_slices[m_current].sentinel->second.Next();
+        }
+        return entry;
+    }
+
+    std::vector<Slice> m_slices;
+    size_t m_current{0};
     bool m_will_erase;
 };
 
@@ -355,11 +461,21 @@ public:
 };
 
 
-/** CCoinsView that adds a memory cache for transactions to another CCoinsView */
+/**
+ * CCoinsView that adds a memory cache for transactions to another CCoinsView
+ *
+ * The cache can be partitioned into several shards by outpoint hash. A sharded
+ * cache supports concurrent reads through PeekCoin() from any thread, while
+ * its owner (e.g. the thread holding cs_main for the chainstate's cache) keeps
+ * using and modifying it as usual. All other methods must only be called by
+ * the owner.
+ */
 class CCoinsViewCache : public CCoinsViewBacked
 {
 private:
     const bool m_deterministic;
+    //! Selects the shard of an outpoint. Unused if there is only one shard.
+    const SaltedOutpointHasher m_shard_hasher;
 
 protected:
     /**
@@ -367,16 +483,27 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
-    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
-    /* The starting sentinel of the flagged entry circular doubly linked list. */
-    mutable CoinsCachePair m_sentinel;
-    mutable CCoinsMap cacheCoins;
+    //! The hash partitions of the cache. Never empty.
+    std::vector<std::unique_ptr<CoinsCacheShard>> m_shards;
 
-    /* Cached dynamic memory usage for the inner Coin objects. */
-    mutable size_t cachedCoinsUsage{0};
+    //! Whether modifications lock the affected shard, so that PeekCoin may be called concurrently.
+    bool ConcurrentReads() const { return m_shards.size() > 1; }
+
+    CoinsCacheShard& GetShard(const COutPoint& outpoint) const
+    {
+        if (m_shards.size() == 1) return *m_shards.front();
+        return *m_shards[m_shard_hasher(outpoint) % m_shards.size()];
+    }
+
+    //! Lock to hold while modifying a shard. Does not lock anything if concurrent reads are not supported.
+    std::unique_lock<std::shared_mutex> WriteLock(CoinsCacheShard& shard) const
+    {
+        if (!ConcurrentReads()) return {};
+        return std::unique_lock{shard.m_mutex};
+    }
 
 public:
-    CCoinsViewCache(CCoinsView *baseIn, bool deterministic = false);
+    CCoinsViewCache(CCoinsView *baseIn, bool deterministic = false, size_t num_shards = 1);
 
     /**
      * By deleting the copy constructor, we prevent accidentally using it when one intends to create a cache on top of a base cache.
@@ -400,6 +527,19 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Return a copy of the unspent coin for the given outpoint, consulting the
+     * backing view on a miss but without filling the cache.
+     *
+     * Unlike all other methods, this may be called from any thread while the
+     * owner is modifying the cache, provided the cache has more than one shard
+     * and the backing view supports concurrent reads (like CCoinsViewDB). The
+     * result is not synchronized with a block being connected or the cache
+     * being flushed, and may reflect the state just before or after any
+     * individual coin modification.
+     */
+    std::optional<Coin> PeekCoin(const COutPoint& outpoint) const;
+
     /**
      * Return a reference to Coin in the cache, or coinEmpty if not found. This is
      * more efficient than GetCoin.
@@ -427,6 +567,17 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Insert an unspent coin that was read from the backing view by another
+     * thread, leaving it unflagged as if it had been fetched by this cache.
+     * Returns false and does nothing if the cache already has an entry for
+     * the outpoint.
+     *
+     * NOT FOR GENERAL USE. Used only when prefetching block inputs.
+     * @sa InputFetcher::FetchInputs()
+     */
+    bool EmplaceCoinFromBase(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -451,6 +602,17 @@ public:
      */
     bool Sync();
 
+    /**
+     * Push the modifications applied to this cache to its base like Sync(), and
+     * then erase the entries which were used longest ago, modified or not,
+     * until DynamicMemoryUsage() - ReusableMemoryUsage() is at most max_usage.
+     * Unlike Flush(), the recently used entries stay cached, and new entries
+     * reuse the memory of the erased ones. The entries of a sharded cache are
+     * evicted from each shard in turn, down to its share of max_usage.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool SyncAndEvict(size_t max_usage);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
@@ -460,9 +622,16 @@ public:
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
+    //! Number of hash partitions of the cache
+    size_t GetShardCount() const { return m_shards.size(); }
+
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Calculate the memory (in bytes) which is part of DynamicMemoryUsage() but
+    //! free to be reused by new entries, e.g. after erasing entries.
+    size_t ReusableMemoryUsage() const;
+
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
@@ -481,7 +650,10 @@ private:
      * @note this is marked const, but may actually append to `cacheCoins`, increasing
      * memory usage.
      */
-    CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+    CCoinsMap::iterator FetchCoin(CoinsCacheShard& shard, const COutPoint &outpoint) const;
+
+    //! Get a cursor over the flagged entries of all shards.
+    CoinsViewCacheCursor FlaggedCursor(bool will_erase) const;
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -482,6 +482,21 @@ public:
             }
         return false;
     }
+
+    /** for_each calls fn on every element that is not marked for garbage
+     * collection, for example to save the contents of the cache.
+     *
+     * for_each must not be called concurrently with insert.
+     *
+     * @param fn the function to call with each element
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const
+    {
+        for (uint32_t i = 0; i < size; ++i)
+            if (!collection_flags.bit_is_set(i))
+                fn(table[i]);
+    }
 };
 } // namespace CuckooCache
 
@@ -0,0 +1,216 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INPUTFETCHER_H
+#define BITCOIN_INPUTFETCHER_H
+
+#include <coins.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/hasher.h>
+#include <util/threadnames.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Prefetcher that warms a CCoinsViewCache with the inputs of a block before
+ * the block is connected.
+ *
+ * The master thread collects all inputs of a block which are neither created
+ * earlier in the same block nor already present in the cache, and hands them
+ * to N-1 worker threads which look them up in the backing view. When the
+ * master is done handing out work it joins the worker pool as an N'th fetcher
+ * until all lookups are done, and finally inserts the fetched coins into the
+ * cache.
+ *
+ * Only the master thread ever touches the cache. Worker threads only call
+ * GetCoin on the backing view, which therefore must be safe to read from
+ * concurrently (as CCoinsViewDB is, since LevelDB reads are thread-safe), and
+ * must not be written to while FetchInputs is running.
+ */
+class InputFetcher
+{
+public:
+    struct Stats {
+        //! Inputs spending an output that was not created in the same block.
+        size_t inputs{0};
+        //! Inputs whose coin was already present in the cache.
+        size_t cache_hits{0};
+        //! Inputs whose coin was read from the backing view and inserted into the cache.
+        size_t fetched{0};
+    };
+
+private:
+    //! Mutex to protect the inner state
+    Mutex m_mutex;
+
+    //! Worker threads block on this when out of work
+    std::condition_variable m_worker_cv;
+
+    //! Master thread blocks on this while workers are still fetching
+    std::condition_variable m_master_cv;
+
+    //! Incremented for every job, so that workers can distinguish a new job from a spurious wakeup.
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+
+    //! The number of threads (including the master) that are working on the current job.
+    int m_active GUARDED_BY(m_mutex){0};
+
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    /**
+     * State of the current job. Only written by the master while holding
+     * m_mutex and no thread is active, and only read by threads counted in
+     * m_active. Each entry of m_coins is written by exactly one thread.
+     */
+    const CCoinsView* m_db{nullptr};
+    std::vector<COutPoint> m_outpoints;
+    std::vector<Coin> m_coins;
+
+    //! Index of the next outpoint to be handed out.
+    std::atomic<size_t> m_next{0};
+
+    //! The maximum number of lookups to claim at once
+    const size_t m_batch_size;
+
+    std::vector<std::thread> m_worker_threads;
+
+    /** Look up claimed batches of outpoints until none are left. */
+    void Work()
+    {
+        const size_t size{m_outpoints.size()};
+        while (true) {
+            const size_t begin{m_next.fetch_add(m_batch_size, std::memory_order_relaxed)};
+            if (begin >= size) return;
+            const size_t end{std::min(begin + m_batch_size, size)};
+            for (size_t i{begin}; i < end; ++i) {
+                if (!m_db->GetCoin(m_outpoints[i], m_coins[i])) {
+                    // The value is unspecified on failure; a spent coin marks it as not found.
+                    m_coins[i].Clear();
+                }
+            }
+        }
+    }
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t generation{0};
+        while (true) {
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_request_stop || m_generation != generation; });
+                if (m_request_stop) return;
+                generation = m_generation;
+                ++m_active;
+            }
+            Work();
+            {
+                LOCK(m_mutex);
+                if (--m_active == 0) m_master_cv.notify_one();
+            }
+        }
+    }
+
+public:
+    //! Create a new input fetcher
+    explicit InputFetcher(size_t batch_size, int worker_threads_num)
+        : m_batch_size(batch_size)
+    {
+        m_worker_threads.reserve(worker_threads_num);
+        for (int n = 0; n < worker_threads_num; ++n) {
+            m_worker_threads.emplace_back([this, n]() {
+                util::ThreadRename(strprintf("inputfetch.%i", n));
+                Loop();
+            });
+        }
+    }
+
+    // Since this class manages its own resources, which is a thread
+    // pool `m_worker_threads`, copy and move operations are not appropriate.
+    InputFetcher(const InputFetcher&) = delete;
+    InputFetcher& operator=(const InputFetcher&) = delete;
+    InputFetcher(InputFetcher&&) = delete;
+    InputFetcher& operator=(InputFetcher&&) = delete;
+
+    /**
+     * Fetch the coins spent by the block from db and insert them into cache.
+     * db must be the view backing cache (or equivalent to it for all
+     * outpoints missing from cache). Does nothing if there are no worker
+     * threads, as a single thread cannot do better than the lazy lookups
+     * ConnectBlock performs anyway.
+     */
+    Stats FetchInputs(CCoinsViewCache& cache, const CCoinsView& db, const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        Stats stats;
+        if (m_worker_threads.empty()) return stats;
+
+        std::unordered_set<Txid, SaltedTxidHasher> txids;
+        txids.reserve(block.vtx.size());
+        std::vector<COutPoint> outpoints;
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& txin : tx->vin) {
+                    // Outputs created earlier in this block are not in the UTXO set yet.
+                    if (txids.contains(txin.prevout.hash)) continue;
+                    ++stats.inputs;
+                    if (cache.HaveCoinInCache(txin.prevout)) {
+                        ++stats.cache_hits;
+                        continue;
+                    }
+                    outpoints.push_back(txin.prevout);
+                }
+            }
+            txids.insert(tx->GetHash());
+        }
+        if (outpoints.empty()) return stats;
+
+        {
+            WAIT_LOCK(m_mutex, lock);
+            // Wait for stragglers of a previous job before replacing its state.
+            m_master_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_active == 0; });
+            m_db = &db;
+            m_outpoints = std::move(outpoints);
+            m_coins.clear();
+            m_coins.resize(m_outpoints.size());
+            m_next.store(0, std::memory_order_relaxed);
+            ++m_generation;
+            ++m_active;
+        }
+        m_worker_cv.notify_all();
+        Work();
+        {
+            WAIT_LOCK(m_mutex, lock);
+            --m_active;
+            m_master_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_active == 0; });
+        }
+
+        for (size_t i{0}; i < m_outpoints.size(); ++i) {
+            if (m_coins[i].IsSpent()) continue;
+            if (cache.EmplaceCoinFromBase(m_outpoints[i], std::move(m_coins[i]))) ++stats.fetched;
+        }
+        return stats;
+    }
+
+    ~InputFetcher()
+    {
+        WITH_LOCK(m_mutex, m_request_stop = true);
+        m_worker_cv.notify_all();
+        for (std::thread& t : m_worker_threads) {
+            t.join();
+        }
+    }
+
+    bool HasThreads() const { return !m_worker_threads.empty(); }
+};
+
+#endif // BITCOIN_INPUTFETCHER_H
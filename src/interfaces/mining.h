@@ -7,9 +7,9 @@
 
 #include <consensus/amount.h>       // for CAmount
 #include <interfaces/types.h>       // for BlockRef
-#include <node/types.h>             // for BlockCreateOptions
+#include <node/types.h>             // for BlockCreateOptions, BlockWaitOptions
 #include <primitives/block.h>       // for CBlock, CBlockHeader
-#include <primitives/transaction.h> // for CTransactionRef
+#include <primitives/transaction.h> // for CTransactionRef, Txid
 #include <stdint.h>                 // for int64_t
 #include <uint256.h>                // for uint256
 #include <util/time.h>              // for MillisecondsDouble
@@ -42,6 +42,25 @@ public:
     virtual CTransactionRef getCoinbaseTx() = 0;
     virtual std::vector<unsigned char> getCoinbaseCommitment() = 0;
     virtual int getWitnessCommitmentIndex() = 0;
+
+    /**
+     * Wait for the chain tip to change, or for the fees of a new template on
+     * the same tip to exceed the fees of this one by the fee threshold.
+     *
+     * @param[in] options how long to wait and the fee threshold
+     * @returns a new template, paying to the same script with the same
+     *          options, or nullptr on timeout or shutdown
+     */
+    virtual std::unique_ptr<BlockTemplate> waitNext(node::BlockWaitOptions options = {}) = 0;
+
+    //! Transactions in this template that were not in the template waitNext()
+    //! was called on, in block order. For a template returned by
+    //! createNewBlock(), all transactions but the coinbase.
+    virtual std::vector<CTransactionRef> getAddedTransactions() = 0;
+
+    //! Txids of the transactions in the template waitNext() was called on
+    //! that are not in this template.
+    virtual std::vector<Txid> getRemovedTransactions() = 0;
 };
 
 //! Interface giving clients (RPC, Stratum v2 Template Provider in the future)
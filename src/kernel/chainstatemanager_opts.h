@@ -22,6 +22,7 @@ class CChainParams;
 class ValidationSignals;
 
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED{true};
+static constexpr bool DEFAULT_PRELOAD_BLOCKS{true};
 static constexpr auto DEFAULT_MAX_TIP_AGE{24h};
 
 namespace kernel {
@@ -49,6 +50,10 @@ struct ChainstateManagerOpts {
     ValidationSignals* signals{nullptr};
     //! Number of script check worker threads. Zero means no parallel verification.
     int worker_threads_num{0};
+    //! Number of input prefetch worker threads. Zero means block inputs are not prefetched.
+    int prefetch_threads_num{0};
+    //! Prepare the next block to connect in a background thread while the current one is being connected.
+    bool preload_blocks{DEFAULT_PRELOAD_BLOCKS};
     size_t script_execution_cache_bytes{DEFAULT_SCRIPT_EXECUTION_CACHE_BYTES};
     size_t signature_cache_bytes{DEFAULT_SIGNATURE_CACHE_BYTES};
 };
@@ -27,6 +27,10 @@ static constexpr bool DEFAULT_MEMPOOL_FULL_RBF{true};
 static constexpr bool DEFAULT_PERSIST_V1_DAT{false};
 /** Default for -acceptnonstdtxn */
 static constexpr bool DEFAULT_ACCEPT_NON_STD_TXN{false};
+/** Default for -mempoollinearizethreads, the number of threads linearizing mempool clusters in the background */
+static constexpr int DEFAULT_MEMPOOL_LINEARIZATION_THREADS{0};
+/** Maximum number of threads linearizing mempool clusters */
+static constexpr int MAX_MEMPOOL_LINEARIZATION_THREADS{15};
 
 namespace kernel {
 /**
@@ -57,6 +61,8 @@ struct MemPoolOptions {
     bool require_standard{true};
     bool full_rbf{DEFAULT_MEMPOOL_FULL_RBF};
     bool persist_v1_dat{DEFAULT_PERSIST_V1_DAT};
+    /** Number of worker threads linearizing clusters after blocks and in idle time; 0 linearizes on demand only. */
+    int linearization_threads{DEFAULT_MEMPOOL_LINEARIZATION_THREADS};
     MemPoolLimits limits{};
 
     ValidationSignals* signals{nullptr};
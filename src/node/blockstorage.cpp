@@ -1030,16 +1030,16 @@ bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) cons
 {
     block.SetNull();
 
-    // Open history file to read
-    AutoFile filein{OpenBlockFile(pos, true)};
-    if (filein.IsNull()) {
-        LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
+    // Read the whole block with a single read, deobfuscating it in one pass,
+    // rather than reading and deobfuscating every field from the file.
+    std::vector<uint8_t> block_data;
+    if (!ReadRawBlockFromDisk(block_data, pos)) {
         return false;
     }
 
     // Read block
     try {
-        filein >> TX_WITH_WITNESS(block);
+        SpanReader{block_data} >> TX_WITH_WITNESS(block);
     } catch (const std::exception& e) {
         LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), pos.ToString());
         return false;
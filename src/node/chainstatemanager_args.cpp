@@ -63,6 +63,17 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
     opts.worker_threads_num = std::clamp(script_threads - 1, 0, MAX_SCRIPTCHECK_THREADS);
     LogPrintf("Script verification uses %d additional threads\n", opts.worker_threads_num);
 
+    int prefetch_threads = args.GetIntArg("-parprefetch", DEFAULT_PREFETCH_THREADS);
+    if (prefetch_threads <= 0) {
+        // Same semantics as -par: 0 means autodetect, -n means leave n cores free
+        prefetch_threads += GetNumCores();
+    }
+    // Subtract 1 because the main thread counts towards the prefetch threads.
+    opts.prefetch_threads_num = std::clamp(prefetch_threads - 1, 0, MAX_PREFETCH_THREADS);
+    LogPrintf("Input prefetching uses %d additional threads\n", opts.prefetch_threads_num);
+
+    if (auto value{args.GetBoolArg("-preloadblocks")}) opts.preload_blocks = *value;
+
     if (auto max_size = args.GetIntArg("-maxsigcachesize")) {
         // 1. When supplied with a max_size of 0, both the signature cache and
         //    script execution cache create the minimum possible cache (2
@@ -14,6 +14,10 @@ class ArgsManager;
 static constexpr int MAX_SCRIPTCHECK_THREADS{15};
 /** -par default (number of script-checking threads, 0 = auto) */
 static constexpr int DEFAULT_SCRIPTCHECK_THREADS{0};
+/** Maximum number of dedicated input prefetch threads allowed */
+static constexpr int MAX_PREFETCH_THREADS{15};
+/** -parprefetch default (number of input prefetch threads, 1 = disabled) */
+static constexpr int DEFAULT_PREFETCH_THREADS{1};
 
 namespace node {
 [[nodiscard]] util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManager::Options& opts);
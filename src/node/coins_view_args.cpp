@@ -7,10 +7,15 @@
 #include <common/args.h>
 #include <txdb.h>
 
+#include <algorithm>
+
 namespace node {
 void ReadCoinsViewArgs(const ArgsManager& args, CoinsViewOptions& options)
 {
     if (auto value = args.GetIntArg("-dbbatchsize")) options.batch_write_bytes = *value;
     if (auto value = args.GetIntArg("-dbcrashratio")) options.simulate_crash_ratio = *value;
+    options.background_flush = args.GetBoolArg("-dbbackgroundflush", DEFAULT_DB_BACKGROUND_FLUSH);
+    options.cache_evict_percent = std::clamp<int64_t>(args.GetIntArg("-coinscacheevict", DEFAULT_COINS_CACHE_EVICT_PERCENT), 0, 100);
+    options.cache_shards = std::clamp<int64_t>(args.GetIntArg("-coinscacheshards", DEFAULT_COINS_CACHE_SHARDS), 1, MAX_COINS_CACHE_SHARDS);
 }
 } // namespace node
@@ -14,6 +14,7 @@
 #include <net_processing.h>
 #include <netgroup.h>
 #include <node/kernel_notifications.h>
+#include <node/miner.h>
 #include <node/warnings.h>
 #include <policy/fees.h>
 #include <scheduler.h>
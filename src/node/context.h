@@ -40,6 +40,7 @@ class SignalInterrupt;
 }
 
 namespace node {
+class BlockTemplateCache;
 class KernelNotifications;
 class Warnings;
 
@@ -77,6 +78,8 @@ struct NodeContext {
     //! Reference to chain client that should used to load or create wallets
     //! opened by the gui.
     std::unique_ptr<interfaces::Mining> mining;
+    //! Block template maintained as the mempool changes, if enabled with -blocktemplatecache.
+    std::unique_ptr<BlockTemplateCache> block_template_cache;
     interfaces::WalletLoader* wallet_loader{nullptr};
     std::unique_ptr<CScheduler> scheduler;
     std::function<void()> rpc_interruption_point = [] {};
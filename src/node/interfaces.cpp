@@ -63,8 +63,10 @@
 #include <config/bitcoin-config.h> // IWYU pragma: keep
 
 #include <any>
+#include <condition_variable>
 #include <memory>
 #include <optional>
+#include <unordered_set>
 #include <utility>
 
 #include <boost/signals2/signal.hpp>
@@ -867,12 +869,74 @@ public:
     NodeContext& m_node;
 };
 
+std::unique_ptr<CBlockTemplate> CreateBlockTemplate(NodeContext& node, const CScript& script_pub_key, const BlockCreateOptions& options)
+{
+    if (node.block_template_cache && options == node.block_template_cache->GetOptions()) {
+        return node.block_template_cache->GetTemplate(script_pub_key);
+    }
+    BlockAssembler::Options assemble_options{options};
+    ApplyArgsManOptions(*Assert(node.args), assemble_options);
+    return BlockAssembler{Assert(node.chainman)->ActiveChainstate(), node.mempool.get(), assemble_options}.CreateNewBlock(script_pub_key);
+}
+
+//! The mempool's sequence number, to be taken before building a template to tell whether the mempool changed since.
+uint64_t GetMempoolSequence(const NodeContext& node)
+{
+    return node.mempool ? WITH_LOCK(node.mempool->cs, return node.mempool->GetSequence()) : 0;
+}
+
+/** Wakes up BlockTemplateImpl::waitNext() when the mempool or the tip changes. */
+class TemplateChangeListener final : public CValidationInterface
+{
+public:
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_changed GUARDED_BY(m_mutex){false};
+
+protected:
+    void TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence) override { Notify(); }
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override { Notify(); }
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override { Notify(); }
+
+private:
+    void Notify() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_changed = true);
+        m_cv.notify_all();
+    }
+};
+
 class BlockTemplateImpl : public BlockTemplate
 {
 public:
-    explicit BlockTemplateImpl(std::unique_ptr<CBlockTemplate> block_template) : m_block_template(std::move(block_template))
+    explicit BlockTemplateImpl(const CScript& script_pub_key,
+                               const BlockCreateOptions& options,
+                               std::unique_ptr<CBlockTemplate> block_template,
+                               uint64_t mempool_sequence,
+                               NodeContext& node,
+                               const CBlockTemplate* previous = nullptr)
+        : m_script_pub_key(script_pub_key),
+          m_options(options),
+          m_block_template(std::move(block_template)),
+          m_mempool_sequence(mempool_sequence),
+          m_node(node)
     {
         assert(m_block_template);
+        const auto& vtx{m_block_template->block.vtx};
+        if (!previous) {
+            m_added.assign(vtx.begin() + 1, vtx.end());
+            return;
+        }
+        std::unordered_set<Txid, SaltedTxidHasher> previous_txids;
+        for (const auto& tx : previous->block.vtx) previous_txids.insert(tx->GetHash());
+        std::unordered_set<Txid, SaltedTxidHasher> txids;
+        for (auto it{vtx.begin() + 1}; it != vtx.end(); ++it) {
+            txids.insert((*it)->GetHash());
+            if (!previous_txids.contains((*it)->GetHash())) m_added.push_back(*it);
+        }
+        for (auto it{previous->block.vtx.begin() + 1}; it != previous->block.vtx.end(); ++it) {
+            if (!txids.contains((*it)->GetHash())) m_removed.push_back((*it)->GetHash());
+        }
     }
 
     CBlockHeader getBlockHeader() override
@@ -910,7 +974,92 @@ public:
         return GetWitnessCommitmentIndex(m_block_template->block);
     }
 
+    std::unique_ptr<BlockTemplate> waitNext(BlockWaitOptions options) override
+    {
+        // Templates may outlive the node components they are built from, which
+        // are torn down at shutdown.
+        if (!m_node.chainman || !m_node.mempool || !m_node.notifications || !m_node.validation_signals || chainman().m_interrupt) {
+            return nullptr;
+        }
+        // Without a fee threshold, only a tip change yields a new template.
+        // Otherwise mempool changes are listened to as well, building at most
+        // one template per interval after one happened.
+        std::shared_ptr<TemplateChangeListener> listener;
+        if (options.fee_threshold < MAX_MONEY) {
+            listener = std::make_shared<TemplateChangeListener>();
+            m_node.validation_signals->RegisterSharedValidationInterface(listener);
+        }
+        auto block_template{WaitNextTemplate(options, listener.get())};
+        if (listener) m_node.validation_signals->UnregisterSharedValidationInterface(listener);
+        return block_template;
+    }
+
+    std::vector<CTransactionRef> getAddedTransactions() override
+    {
+        return m_added;
+    }
+
+    std::vector<Txid> getRemovedTransactions() override
+    {
+        return m_removed;
+    }
+
+    std::unique_ptr<BlockTemplate> WaitNextTemplate(const BlockWaitOptions& options, TemplateChangeListener* listener)
+    {
+        // Interrupt check interval, and minimum interval between templates built for mempool changes
+        const MillisecondsDouble tick{1000};
+        auto now{std::chrono::steady_clock::now()};
+        auto deadline = now + options.timeout;
+        // std::chrono does not check against overflow
+        if (deadline < now) deadline = std::chrono::steady_clock::time_point::max();
+        const uint256& prev_hash{m_block_template->block.hashPrevBlock};
+        const CAmount fees{-m_block_template->vTxFees[0]};
+        //! Whether the mempool changed since the last template was built, and when the next one may be.
+        bool mempool_changed{listener && GetMempoolSequence(m_node) != m_mempool_sequence};
+        decltype(deadline) next_template{now};
+        while (true) {
+            if (listener) {
+                WAIT_LOCK(listener->m_mutex, lock);
+                // Once a change happened, only wait for the next template to be due.
+                const auto wake{std::min(deadline, mempool_changed ? std::max<decltype(deadline)>(next_template, now) : now + tick)};
+                listener->m_cv.wait_until(lock, wake, [&]() EXCLUSIVE_LOCKS_REQUIRED(listener->m_mutex) {
+                    return (!mempool_changed && listener->m_changed) || chainman().m_interrupt;
+                });
+                mempool_changed |= std::exchange(listener->m_changed, false);
+            } else {
+                WAIT_LOCK(notifications().m_tip_block_mutex, lock);
+                notifications().m_tip_block_cv.wait_until(lock, std::min(deadline, now + tick), [&]() EXCLUSIVE_LOCKS_REQUIRED(notifications().m_tip_block_mutex) {
+                    return notifications().m_tip_block != prev_hash || chainman().m_interrupt;
+                });
+            }
+            if (chainman().m_interrupt) return nullptr;
+            const bool tip_changed{WITH_LOCK(notifications().m_tip_block_mutex, return notifications().m_tip_block != prev_hash)};
+            now = std::chrono::steady_clock::now();
+            // Must not hold m_tip_block_mutex when creating a template, which locks cs_main.
+            if (tip_changed || (mempool_changed && now >= next_template)) {
+                mempool_changed = false;
+                next_template = now + tick;
+                const uint64_t mempool_sequence{GetMempoolSequence(m_node)};
+                auto block_template{CreateBlockTemplate(m_node, m_script_pub_key, m_options)};
+                if (block_template->block.hashPrevBlock != prev_hash || -block_template->vTxFees[0] - fees >= options.fee_threshold) {
+                    return std::make_unique<BlockTemplateImpl>(m_script_pub_key, m_options, std::move(block_template), mempool_sequence, m_node, m_block_template.get());
+                }
+            }
+            if (now >= deadline) return nullptr;
+        }
+    }
+
+    ChainstateManager& chainman() { return *Assert(m_node.chainman); }
+    KernelNotifications& notifications() { return *Assert(m_node.notifications); }
+
+    const CScript m_script_pub_key;
+    const BlockCreateOptions m_options;
     const std::unique_ptr<CBlockTemplate> m_block_template;
+    //! Sequence number of the mempool before this template was built
+    const uint64_t m_mempool_sequence;
+    std::vector<CTransactionRef> m_added;
+    std::vector<Txid> m_removed;
+    NodeContext& m_node;
 };
 
 class MinerImpl : public Mining
@@ -982,9 +1131,8 @@ public:
 
     std::unique_ptr<BlockTemplate> createNewBlock(const CScript& script_pub_key, const BlockCreateOptions& options) override
     {
-        BlockAssembler::Options assemble_options{options};
-        ApplyArgsManOptions(*Assert(m_node.args), assemble_options);
-        return std::make_unique<BlockTemplateImpl>(BlockAssembler{chainman().ActiveChainstate(), context()->mempool.get(), assemble_options}.CreateNewBlock(script_pub_key));
+        const uint64_t mempool_sequence{GetMempoolSequence(m_node)};
+        return std::make_unique<BlockTemplateImpl>(script_pub_key, options, CreateBlockTemplate(m_node, script_pub_key, options), mempool_sequence, m_node);
     }
 
     NodeContext* context() override { return &m_node; }
@@ -18,6 +18,7 @@
 #include <util/moneystr.h>
 #include <util/translation.h>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 
@@ -99,6 +100,8 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& argsman, const CChainP
 
     mempool_opts.persist_v1_dat = argsman.GetBoolArg("-persistmempoolv1", mempool_opts.persist_v1_dat);
 
+    mempool_opts.linearization_threads = std::clamp<int64_t>(argsman.GetIntArg("-mempoollinearizethreads", mempool_opts.linearization_threads), 0, MAX_MEMPOOL_LINEARIZATION_THREADS);
+
     ApplyArgsManOptions(argsman, mempool_opts.limits);
 
     return {};
@@ -426,4 +426,192 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         nDescendantsUpdated += UpdatePackagesForAdded(mempool, ancestors, mapModifiedTx);
     }
 }
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options,
+                                       std::chrono::milliseconds rebuild_interval)
+    : m_chainman{chainman},
+      m_mempool{mempool},
+      m_options{ClampOptions(options)},
+      m_rebuild_interval{rebuild_interval}
+{
+}
+
+void BlockTemplateCache::Rebuild()
+{
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(m_mutex);
+    m_template.reset();
+    m_in_block.clear();
+    m_template = BlockAssembler{m_chainman.ActiveChainstate(), &m_mempool, m_options}.CreateNewBlock(CScript() << OP_TRUE);
+    m_last_rebuild = SteadyClock::now();
+    m_stale = false;
+    m_coinbase_outdated = false;
+    m_unchecked = false;
+
+    const CBlock& block{m_template->block};
+    m_prev = m_chainman.m_blockman.LookupBlockIndex(block.hashPrevBlock);
+    m_block_weight = m_options.coinbase_max_additional_weight;
+    m_block_sigops_cost = m_options.coinbase_output_max_additional_sigops;
+    m_fees = -m_template->vTxFees[0];
+    for (size_t i{1}; i < block.vtx.size(); ++i) {
+        m_in_block.insert(block.vtx[i]->GetHash());
+        m_block_weight += GetTransactionWeight(*block.vtx[i]);
+        m_block_sigops_cost += m_template->vTxSigOpsCost[i];
+    }
+}
+
+void BlockTemplateCache::MaybeRebuild()
+{
+    AssertLockHeld(m_mutex);
+    if (!m_template || !m_stale || SteadyClock::now() - m_last_rebuild < m_rebuild_interval) return;
+    try {
+        Rebuild();
+    } catch (const std::exception& e) {
+        LogError("Failed to rebuild the cached block template: %s\n", e.what());
+        m_template.reset();
+    }
+}
+
+void BlockTemplateCache::UpdateCoinbase()
+{
+    AssertLockHeld(m_mutex);
+    CBlock& block{m_template->block};
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vout[0].nValue = m_fees + GetBlockSubsidy(m_prev->nHeight + 1, m_chainman.GetConsensus());
+    const int commitment_index{GetWitnessCommitmentIndex(block)};
+    if (commitment_index != NO_WITNESS_COMMITMENT) coinbase.vout.erase(coinbase.vout.begin() + commitment_index);
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    m_template->vchCoinbaseCommitment = m_chainman.GenerateCoinbaseCommitment(block, m_prev);
+    m_template->vTxFees[0] = -m_fees;
+    m_coinbase_outdated = false;
+}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateCache::GetTemplate(const CScript& scriptPubKeyIn)
+{
+    LOCK2(::cs_main, m_mutex);
+    CBlockIndex* tip{m_chainman.ActiveChain().Tip()};
+    if (!m_template || m_prev != tip) Rebuild();
+    if (m_coinbase_outdated) UpdateCoinbase();
+    if (m_unchecked && m_options.test_block_validity) {
+        BlockValidationState state;
+        if (!TestBlockValidity(state, m_chainman.GetParams(), m_chainman.ActiveChainstate(), m_template->block, tip,
+                               /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/false)) {
+            LogWarning("Cached block template is invalid (%s), rebuilding it\n", state.ToString());
+            Rebuild();
+        }
+        m_unchecked = false;
+    }
+
+    auto block_template{std::make_unique<CBlockTemplate>(*m_template)};
+    CBlock& block{block_template->block};
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vout[0].scriptPubKey = scriptPubKeyIn;
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    block_template->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*block.vtx[0]);
+    UpdateTime(&block, m_chainman.GetConsensus(), m_prev);
+    return block_template;
+}
+
+void BlockTemplateCache::Invalidate()
+{
+    LOCK(m_mutex);
+    m_template.reset();
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence)
+{
+    LOCK2(::cs_main, m_mutex);
+    if (!m_template) return;
+    const Txid& txid{tx.info.m_tx->GetHash()};
+    if (m_in_block.contains(txid)) return;
+    {
+        LOCK(m_mempool.cs);
+        // The tip changed and the template will be rebuilt, or the
+        // transaction was already removed again.
+        if (m_chainman.ActiveChain().Tip() != m_prev) return;
+        const auto it{m_mempool.GetIter(txid)};
+        if (!it) return;
+        const CTxMemPoolEntry& entry{**it};
+
+        if (entry.GetModifiedFee() < m_options.blockMinFeeRate.GetFee(entry.GetTxSize())) {
+            // BlockAssembler would only include it along with a descendant,
+            // which will not be appended either.
+            return;
+        }
+        const bool parents_in_block{std::all_of(entry.GetMemPoolParentsConst().begin(), entry.GetMemPoolParentsConst().end(),
+                                                [&](const CTxMemPoolEntry& parent) EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                                                    return m_in_block.contains(parent.GetTx().GetHash());
+                                                })};
+        if (!parents_in_block ||
+            m_block_weight + entry.GetTxWeight() >= m_options.nBlockMaxWeight ||
+            m_block_sigops_cost + entry.GetSigOpCost() >= MAX_BLOCK_SIGOPS_COST) {
+            m_stale = true;
+        } else if (IsFinalTx(entry.GetTx(), m_prev->nHeight + 1, m_prev->GetMedianTimePast())) {
+            // Its parents come first in the block, so it can go last.
+            m_template->block.vtx.emplace_back(entry.GetSharedTx());
+            m_template->vTxFees.push_back(entry.GetFee());
+            m_template->vTxSigOpsCost.push_back(entry.GetSigOpCost());
+            m_in_block.insert(txid);
+            m_block_weight += entry.GetTxWeight();
+            m_block_sigops_cost += entry.GetSigOpCost();
+            m_fees += entry.GetFee();
+            m_coinbase_outdated = true;
+            m_unchecked = true;
+        }
+    }
+    MaybeRebuild();
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    LOCK2(::cs_main, m_mutex);
+    if (!m_template || !m_in_block.contains(tx->GetHash())) return;
+
+    // Take out the transaction and whatever spends it, which all come after it.
+    CBlock& block{m_template->block};
+    std::unordered_set<Txid, SaltedTxidHasher> removed{tx->GetHash()};
+    size_t kept{1};
+    for (size_t i{1}; i < block.vtx.size(); ++i) {
+        const CTransaction& block_tx{*block.vtx[i]};
+        const bool remove{removed.contains(block_tx.GetHash()) ||
+                          std::any_of(block_tx.vin.begin(), block_tx.vin.end(), [&](const CTxIn& txin) {
+                              return removed.contains(txin.prevout.hash);
+                          })};
+        if (remove) {
+            removed.insert(block_tx.GetHash());
+            m_in_block.erase(block_tx.GetHash());
+            m_block_weight -= GetTransactionWeight(block_tx);
+            m_block_sigops_cost -= m_template->vTxSigOpsCost[i];
+            m_fees -= m_template->vTxFees[i];
+            continue;
+        }
+        block.vtx[kept] = std::move(block.vtx[i]);
+        m_template->vTxFees[kept] = m_template->vTxFees[i];
+        m_template->vTxSigOpsCost[kept] = m_template->vTxSigOpsCost[i];
+        ++kept;
+    }
+    block.vtx.resize(kept);
+    m_template->vTxFees.resize(kept);
+    m_template->vTxSigOpsCost.resize(kept);
+    m_coinbase_outdated = true;
+    m_unchecked = true;
+    // Other transactions may fit in the space that was freed.
+    m_stale = true;
+    MaybeRebuild();
+}
+
+void BlockTemplateCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    LOCK2(::cs_main, m_mutex);
+    if (fInitialDownload) {
+        m_template.reset();
+        return;
+    }
+    try {
+        Rebuild();
+    } catch (const std::exception& e) {
+        LogError("Failed to build the cached block template: %s\n", e.what());
+        m_template.reset();
+    }
+}
 } // namespace node
@@ -6,14 +6,20 @@
 #ifndef BITCOIN_NODE_MINER_H
 #define BITCOIN_NODE_MINER_H
 
+#include <kernel/cs_main.h>
 #include <node/types.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <util/time.h>
+#include <validationinterface.h>
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <stdint.h>
+#include <unordered_set>
 
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/indexed_by.hpp>
@@ -32,6 +38,9 @@ namespace Consensus { struct Params; };
 
 namespace node {
 static const bool DEFAULT_PRINT_MODIFIED_FEE = false;
+static const bool DEFAULT_BLOCK_TEMPLATE_CACHE{false};
+//! Minimum time between two rebuilds of a stale cached block template.
+static constexpr std::chrono::milliseconds DEFAULT_BLOCK_TEMPLATE_REBUILD_INTERVAL{1000};
 
 struct CBlockTemplate
 {
@@ -204,6 +213,83 @@ private:
     void SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries);
 };
 
+/**
+ * Block template on top of the active chain tip, maintained incrementally as
+ * transactions enter and leave the mempool, so that a template is available
+ * without running BlockAssembler for every request.
+ *
+ * The template is rebuilt when the tip changes. A transaction added to the
+ * mempool is appended to it if its unconfirmed parents already are in it and
+ * it fits; a transaction removed from the mempool is taken out of it, along
+ * with whatever spends it. Whenever the template may have become worse than
+ * the one BlockAssembler would build, for instance because a transaction did
+ * not fit or pays for a parent that is not in it, the template is marked
+ * stale and rebuilt, at most once per rebuild interval.
+ *
+ * The template pays to a placeholder script, replaced by GetTemplate(). Unless
+ * disabled in the options, a template that changed since it was built is
+ * checked with TestBlockValidity before it is handed out, like BlockAssembler
+ * checks the blocks it creates.
+ *
+ * cs_main is always locked before the internal mutex.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options,
+                       std::chrono::milliseconds rebuild_interval = DEFAULT_BLOCK_TEMPLATE_REBUILD_INTERVAL);
+
+    const BlockAssembler::Options& GetOptions() const { return m_options; }
+
+    /** Return a copy of the template for the current tip, paying to scriptPubKeyIn. */
+    std::unique_ptr<CBlockTemplate> GetTemplate(const CScript& scriptPubKeyIn) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Drop the template, to be rebuilt when it is next requested. Used when
+     * the modified fees of mempool transactions changed, which is not notified.
+     */
+    void Invalidate() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+protected:
+    void TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const BlockAssembler::Options m_options;
+    const std::chrono::milliseconds m_rebuild_interval;
+
+    Mutex m_mutex;
+    std::unique_ptr<CBlockTemplate> m_template GUARDED_BY(m_mutex);
+    //! The block the template builds on.
+    const CBlockIndex* m_prev GUARDED_BY(m_mutex){nullptr};
+    //! Transactions in the template, and their total weight, sigops cost and
+    //! fees, counted like BlockAssembler does.
+    std::unordered_set<Txid, SaltedTxidHasher> m_in_block GUARDED_BY(m_mutex);
+    uint64_t m_block_weight GUARDED_BY(m_mutex){0};
+    int64_t m_block_sigops_cost GUARDED_BY(m_mutex){0};
+    CAmount m_fees GUARDED_BY(m_mutex){0};
+    //! Whether the transactions changed since the coinbase was last updated.
+    bool m_coinbase_outdated GUARDED_BY(m_mutex){false};
+    //! Whether a rebuild could yield a better template.
+    bool m_stale GUARDED_BY(m_mutex){false};
+    //! Whether the transactions changed since the template was checked for validity.
+    bool m_unchecked GUARDED_BY(m_mutex){false};
+    SteadyClock::time_point m_last_rebuild GUARDED_BY(m_mutex);
+
+    /** Build the template from scratch on top of the current tip. */
+    void Rebuild() EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mutex);
+    /** Rebuild the template if it is stale and was not rebuilt recently, or drop it if that fails. */
+    void MaybeRebuild() EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mutex);
+    /** Update the coinbase value and witness commitment after the transactions changed. */
+    void UpdateCoinbase() EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mutex);
+};
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
@@ -0,0 +1,126 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/sigcache_persist.h>
+
+#include <clientversion.h>
+#include <common/args.h>
+#include <logging.h>
+#include <script/sigcache.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/fs.h>
+#include <util/fs_helpers.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+using fsbridge::FopenFn;
+
+namespace node {
+
+static const uint64_t SIGCACHE_DUMP_VERSION{1};
+
+bool ShouldPersistSigCache(const ArgsManager& argsman)
+{
+    return argsman.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE);
+}
+
+fs::path SigCachePath(const ArgsManager& argsman)
+{
+    return argsman.GetDataDirNet() / "sigcache.dat";
+}
+
+bool LoadSigCache(ValidationCache& validation_cache, const fs::path& load_path, FopenFn mockable_fopen_function)
+{
+    AssertLockHeld(::cs_main);
+    if (load_path.empty()) return false;
+
+    AutoFile file{mockable_fopen_function(load_path, "rb")};
+    if (file.IsNull()) {
+        LogInfo("Failed to open signature cache file. Continuing anyway.\n");
+        return false;
+    }
+
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SIGCACHE_DUMP_VERSION) {
+            LogInfo("Unknown signature cache file version %u. Continuing anyway.\n", version);
+            return false;
+        }
+        int client_version;
+        file >> client_version;
+
+        uint256 signature_nonce;
+        std::vector<uint256> signature_entries;
+        file >> signature_nonce >> signature_entries;
+        uint256 script_execution_nonce;
+        std::vector<uint256> script_execution_entries;
+        file >> script_execution_nonce >> script_execution_entries;
+
+        validation_cache.m_signature_cache.Load(signature_nonce, signature_entries);
+        if (client_version != CLIENT_VERSION) {
+            LogInfo("Ignoring %u script execution cache entries from client version %d.\n", script_execution_entries.size(), client_version);
+            script_execution_entries.clear();
+        } else {
+            validation_cache.SetScriptExecutionCacheNonce(script_execution_nonce);
+            for (const uint256& entry : script_execution_entries) {
+                validation_cache.m_script_execution_cache.insert(entry);
+            }
+        }
+        LogInfo("Imported %u signature cache and %u script execution cache entries from file\n",
+                signature_entries.size(), script_execution_entries.size());
+    } catch (const std::exception& e) {
+        LogInfo("Failed to deserialize signature cache data on file: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool DumpSigCache(ValidationCache& validation_cache, const fs::path& dump_path, FopenFn mockable_fopen_function, bool skip_file_commit)
+{
+    AssertLockHeld(::cs_main);
+    auto start = SteadyClock::now();
+
+    const std::vector<uint256> signature_entries{validation_cache.m_signature_cache.GetEntries()};
+    std::vector<uint256> script_execution_entries;
+    validation_cache.m_script_execution_cache.for_each([&](const uint256& entry) { script_execution_entries.push_back(entry); });
+
+    AutoFile file{mockable_fopen_function(dump_path + ".new", "wb")};
+    if (file.IsNull()) {
+        return false;
+    }
+
+    try {
+        file << SIGCACHE_DUMP_VERSION;
+        file << int{CLIENT_VERSION};
+        file << validation_cache.m_signature_cache.GetNonce() << signature_entries;
+        file << validation_cache.ScriptExecutionCacheNonce() << script_execution_entries;
+
+        if (!skip_file_commit && !file.Commit())
+            throw std::runtime_error("Commit failed");
+        file.fclose();
+        if (!RenameOver(dump_path + ".new", dump_path)) {
+            throw std::runtime_error("Rename failed");
+        }
+
+        LogInfo("Dumped %u signature cache and %u script execution cache entries: %.3fs, %d bytes dumped to file\n",
+                signature_entries.size(), script_execution_entries.size(),
+                Ticks<SecondsDouble>(SteadyClock::now() - start),
+                fs::file_size(dump_path));
+    } catch (const std::exception& e) {
+        LogInfo("Failed to dump signature cache: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+} // namespace node
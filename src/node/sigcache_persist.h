@@ -0,0 +1,47 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_SIGCACHE_PERSIST_H
+#define BITCOIN_NODE_SIGCACHE_PERSIST_H
+
+#include <kernel/cs_main.h>
+#include <sync.h>
+#include <util/fs.h>
+
+class ArgsManager;
+class ValidationCache;
+
+namespace node {
+
+/**
+ * Default for -persistsigcache, indicating whether the node should save the
+ * signature and script execution caches on shutdown and load them on start
+ */
+static constexpr bool DEFAULT_PERSIST_SIGCACHE{false};
+
+bool ShouldPersistSigCache(const ArgsManager& argsman);
+fs::path SigCachePath(const ArgsManager& argsman);
+
+/**
+ * Dump the signature and script execution caches to a file, along with the
+ * nonces their entries are salted with. Scripts are only checked while
+ * holding cs_main, so holding it keeps the caches from being modified.
+ */
+bool DumpSigCache(ValidationCache& validation_cache, const fs::path& dump_path,
+                  fsbridge::FopenFn mockable_fopen_function = fsbridge::fopen,
+                  bool skip_file_commit = false) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+/**
+ * Import the file into the signature and script execution caches, which
+ * start using the nonces saved with it. The script execution cache entries
+ * are only imported if the file was written by the same client version, as
+ * the meaning of the script verification flags they commit to may change
+ * between versions; the validity of a signature does not.
+ */
+bool LoadSigCache(ValidationCache& validation_cache, const fs::path& load_path,
+                  fsbridge::FopenFn mockable_fopen_function = fsbridge::fopen) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+} // namespace node
+
+#endif // BITCOIN_NODE_SIGCACHE_PERSIST_H
@@ -13,6 +13,9 @@
 #ifndef BITCOIN_NODE_TYPES_H
 #define BITCOIN_NODE_TYPES_H
 
+#include <consensus/amount.h>
+#include <util/time.h>
+
 #include <cstddef>
 
 namespace node {
@@ -43,6 +46,22 @@ struct BlockCreateOptions {
      * transaction outputs.
      */
     size_t coinbase_output_max_additional_sigops{400};
+
+    friend bool operator==(const BlockCreateOptions&, const BlockCreateOptions&) = default;
+};
+
+struct BlockWaitOptions {
+    /**
+     * How long to wait before giving up on a new template. Default is to
+     * wait forever.
+     */
+    MillisecondsDouble timeout{MillisecondsDouble::max()};
+    /**
+     * Only return a template for the same tip if its fees are higher by at
+     * least this amount. The default of MAX_MONEY only waits for the tip to
+     * change.
+     */
+    CAmount fee_threshold{MAX_MONEY};
 };
 } // namespace node
 
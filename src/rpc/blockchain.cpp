@@ -3078,6 +3078,12 @@ const std::vector<RPCResult> RPCHelpForChainstate{
     {RPCResult::Type::STR_HEX, "snapshot_blockhash", /*optional=*/true, "the base block of the snapshot this chainstate is based on, if any"},
     {RPCResult::Type::NUM, "coins_db_cache_bytes", "size of the coinsdb cache"},
     {RPCResult::Type::NUM, "coins_tip_cache_bytes", "size of the coinstip cache"},
+    {RPCResult::Type::OBJ, "coins_flush", /*optional=*/true, "timing of the writes of the coinstip cache to the coinsdb", {
+        {RPCResult::Type::BOOL, "background", "whether the coinsdb is written in the background (see -dbbackgroundflush)"},
+        {RPCResult::Type::NUM, "last_flush_ms", "time block validation was paused by the most recent flush"},
+        {RPCResult::Type::NUM, "last_write_ms", "duration of the most recently completed coinsdb write"},
+        {RPCResult::Type::NUM, "total_stall_ms", "total time flushes waited for a previous background write to complete"},
+    }},
     {RPCResult::Type::BOOL, "validated", "whether the chainstate is fully validated. True if all blocks in the chainstate were validated, false if the chain is based on a snapshot and the snapshot has not yet been validated."},
 };
 
@@ -3104,7 +3110,7 @@ return RPCHelpMan{
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
 
-    auto make_chain_data = [&](const Chainstate& cs, bool validated) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+    auto make_chain_data = [&](Chainstate& cs, bool validated) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
         UniValue data(UniValue::VOBJ);
         if (!cs.m_chain.Tip()) {
@@ -3119,6 +3125,15 @@ return RPCHelpMan{
         data.pushKV("verificationprogress",  GuessVerificationProgress(Params().TxData(), tip));
         data.pushKV("coins_db_cache_bytes",  cs.m_coinsdb_cache_size_bytes);
         data.pushKV("coins_tip_cache_bytes", cs.m_coinstip_cache_size_bytes);
+        if (cs.HasCoinsViews()) {
+            const CoinsDBWriteStats write_stats{cs.CoinsDB().GetWriteStats()};
+            UniValue flush(UniValue::VOBJ);
+            flush.pushKV("background", chainman.m_options.coins_view.background_flush);
+            flush.pushKV("last_flush_ms", Ticks<std::chrono::milliseconds>(cs.m_last_coins_flush_duration));
+            flush.pushKV("last_write_ms", Ticks<std::chrono::milliseconds>(write_stats.last_write));
+            flush.pushKV("total_stall_ms", Ticks<std::chrono::milliseconds>(write_stats.total_stall));
+            data.pushKV("coins_flush", std::move(flush));
+        }
         if (cs.m_from_snapshot_blockhash) {
             data.pushKV("snapshot_blockhash", cs.m_from_snapshot_blockhash->ToString());
         }
@@ -491,7 +491,11 @@ static RPCHelpMan prioritisetransaction()
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Priority is no longer supported, dummy argument to prioritisetransaction must be 0.");
     }
 
-    EnsureAnyMemPool(request.context).PrioritiseTransaction(hash, nAmount);
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    EnsureMemPool(node).PrioritiseTransaction(hash, nAmount);
+    // The cached template may no longer be the best one, or have the fees it
+    // was built with.
+    if (node.block_template_cache) node.block_template_cache->Invalidate();
     return true;
 },
     };
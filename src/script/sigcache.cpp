@@ -19,21 +19,28 @@
 
 SignatureCache::SignatureCache(const size_t max_size_bytes)
 {
-    uint256 nonce = GetRandHash();
+    SetNonce(GetRandHash());
+
+    const auto [num_elems, approx_size_bytes] = setValid.setup_bytes(max_size_bytes);
+    LogPrintf("Using %zu MiB out of %zu MiB requested for signature cache, able to store %zu elements\n",
+              approx_size_bytes >> 20, max_size_bytes >> 20, num_elems);
+}
+
+void SignatureCache::SetNonce(const uint256& nonce)
+{
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy, and then pad with 'E' for ECDSA and
     // 'S' for Schnorr (followed by 0 bytes).
     static constexpr unsigned char PADDING_ECDSA[32] = {'E'};
     static constexpr unsigned char PADDING_SCHNORR[32] = {'S'};
+    m_nonce = nonce;
+    m_salted_hasher_ecdsa.Reset();
     m_salted_hasher_ecdsa.Write(nonce.begin(), 32);
     m_salted_hasher_ecdsa.Write(PADDING_ECDSA, 32);
+    m_salted_hasher_schnorr.Reset();
     m_salted_hasher_schnorr.Write(nonce.begin(), 32);
     m_salted_hasher_schnorr.Write(PADDING_SCHNORR, 32);
-
-    const auto [num_elems, approx_size_bytes] = setValid.setup_bytes(max_size_bytes);
-    LogPrintf("Using %zu MiB out of %zu MiB requested for signature cache, able to store %zu elements\n",
-              approx_size_bytes >> 20, max_size_bytes >> 20, num_elems);
 }
 
 void SignatureCache::ComputeEntryECDSA(uint256& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
@@ -60,6 +67,23 @@ void SignatureCache::Set(const uint256& entry)
     setValid.insert(entry);
 }
 
+std::vector<uint256> SignatureCache::GetEntries()
+{
+    std::shared_lock<std::shared_mutex> lock(cs_sigcache);
+    std::vector<uint256> entries;
+    setValid.for_each([&](const uint256& entry) { entries.push_back(entry); });
+    return entries;
+}
+
+void SignatureCache::Load(const uint256& nonce, const std::vector<uint256>& entries)
+{
+    std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+    SetNonce(nonce);
+    for (const uint256& entry : entries) {
+        setValid.insert(entry);
+    }
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
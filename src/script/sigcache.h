@@ -41,10 +41,14 @@ private:
     //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
+    //! The random nonce the hashers are salted with.
+    uint256 m_nonce;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     std::shared_mutex cs_sigcache;
 
+    void SetNonce(const uint256& nonce);
+
 public:
     SignatureCache(size_t max_size_bytes);
 
@@ -58,6 +62,20 @@ public:
     bool Get(const uint256& entry, const bool erase);
 
     void Set(const uint256& entry);
+
+    const uint256& GetNonce() const { return m_nonce; }
+
+    //! Return the entries that are not marked for erasure, e.g. to save them.
+    std::vector<uint256> GetEntries();
+
+    /**
+     * Salt entries with the given nonce from now on and add entries computed
+     * with it, e.g. those saved by a previous run. Entries computed with the
+     * previous nonce stop matching and are eventually evicted. Since entries
+     * are computed without locking, this must not be called while the cache
+     * is used by other threads.
+     */
+    void Load(const uint256& nonce, const std::vector<uint256>& entries);
 };
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
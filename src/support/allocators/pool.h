@@ -119,6 +119,11 @@ class PoolResource final
      */
     std::byte* m_available_memory_end = nullptr;
 
+    /**
+     * Total size in bytes of the blocks in all freelists.
+     */
+    std::size_t m_free_list_bytes = 0;
+
     /**
      * How many multiple of ELEM_ALIGN_BYTES are necessary to fit bytes. We use that result directly as an index
      * into m_free_lists. Round up for the special case when bytes==0.
@@ -156,6 +161,7 @@ class PoolResource final
         size_t remaining_available_bytes = std::distance(m_available_memory_it, m_available_memory_end);
         if (0 != remaining_available_bytes) {
             PlacementAddToList(m_available_memory_it, m_free_lists[remaining_available_bytes / ELEM_ALIGN_BYTES]);
+            m_free_list_bytes += remaining_available_bytes;
         }
 
         void* storage = ::operator new (m_chunk_size_bytes, std::align_val_t{ELEM_ALIGN_BYTES});
@@ -217,6 +223,7 @@ public:
                 // we've already got data in the pool's freelist, unlink one element and return the pointer
                 // to the unlinked memory. Since FreeList is trivially destructible we can just treat it as
                 // uninitialized memory.
+                m_free_list_bytes -= num_alignments * ELEM_ALIGN_BYTES;
                 return std::exchange(m_free_lists[num_alignments], m_free_lists[num_alignments]->m_next);
             }
 
@@ -245,6 +252,7 @@ public:
             // put the memory block into the linked list. We can placement construct the FreeList
             // into the memory since we can be sure the alignment is correct.
             PlacementAddToList(p, m_free_lists[num_alignments]);
+            m_free_list_bytes += num_alignments * ELEM_ALIGN_BYTES;
         } else {
             // Can't use the pool => forward deallocation to ::operator delete().
             ::operator delete (p, std::align_val_t{alignment});
@@ -259,6 +267,14 @@ public:
         return m_allocated_chunks.size();
     }
 
+    /**
+     * Number of bytes in the freelists, which are reused before any new chunk is allocated.
+     */
+    [[nodiscard]] std::size_t NumFreeListBytes() const
+    {
+        return m_free_list_bytes;
+    }
+
     /**
      * Size in bytes to allocate per chunk, currently hardcoded to a fixed size.
      */
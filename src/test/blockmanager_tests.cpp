@@ -198,4 +198,40 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     BOOST_CHECK_EQUAL(read_block.nVersion, 2);
 }
 
+BOOST_AUTO_TEST_CASE(blockmanager_read_block)
+{
+    const auto params {CreateChainParams(ArgsManager{}, ChainType::MAIN)};
+    KernelNotifications notifications{*Assert(m_node.shutdown), m_node.exit_status, *Assert(m_node.warnings)};
+    const BlockManager::Options blockman_opts{
+        .chainparams = *params,
+        .use_xor = true,
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+    };
+    BlockManager blockman{*Assert(m_node.shutdown), blockman_opts};
+    const CBlock& genesis{params->GenesisBlock()};
+    const FlatFilePos pos{blockman.SaveBlockToDisk(genesis, 0)};
+
+    // The block is read in one piece and deserialized from memory.
+    CBlock read_block;
+    BOOST_CHECK(blockman.ReadBlockFromDisk(read_block, pos));
+    BOOST_CHECK_EQUAL(read_block.GetHash(), genesis.GetHash());
+    BOOST_CHECK_EQUAL(read_block.vtx.size(), 1U);
+    BOOST_CHECK_EQUAL(read_block.vtx[0]->GetHash(), genesis.vtx[0]->GetHash());
+
+    std::vector<uint8_t> raw_block;
+    BOOST_CHECK(blockman.ReadRawBlockFromDisk(raw_block, pos));
+    BOOST_CHECK_EQUAL(raw_block.size(), ::GetSerializeSize(TX_WITH_WITNESS(genesis)));
+
+    // A position not pointing at a block is rejected before deserializing.
+    {
+        ASSERT_DEBUG_LOG("Block magic mismatch");
+        BOOST_CHECK(!blockman.ReadBlockFromDisk(read_block, FlatFilePos{pos.nFile, pos.nPos + 1}));
+    }
+    {
+        ASSERT_DEBUG_LOG("OpenBlockFile failed");
+        BOOST_CHECK(!blockman.ReadBlockFromDisk(read_block, FlatFilePos{pos.nFile, 0}));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
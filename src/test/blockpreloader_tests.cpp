@@ -0,0 +1,145 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockpreloader.h>
+#include <chain.h>
+#include <consensus/validation.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockpreloader_tests, BasicTestingSetup)
+
+//! Job creating an empty block, after spinning until interrupted if requested.
+static BlockPreloader::Job MakeJob(std::atomic<int>& runs, bool wait_for_interrupt)
+{
+    return [&runs, wait_for_interrupt](BlockPreloader::Result& result, const std::atomic<bool>& interrupt) {
+        ++runs;
+        result.block = std::make_shared<const CBlock>();
+        while (wait_for_interrupt && !interrupt) std::this_thread::yield();
+    };
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    BlockPreloader preloader{/*enabled=*/false};
+    BOOST_CHECK(!preloader.IsEnabled());
+    std::atomic<int> runs{0};
+    const uint256 hash{m_rng.rand256()};
+    preloader.Preload(hash, MakeJob(runs, /*wait_for_interrupt=*/false));
+    BOOST_CHECK(!preloader.Take(hash));
+    preloader.Cancel();
+    BOOST_CHECK_EQUAL(runs, 0);
+}
+
+BOOST_AUTO_TEST_CASE(preload_and_take)
+{
+    BlockPreloader preloader{/*enabled=*/true};
+    BOOST_CHECK(preloader.IsEnabled());
+    std::atomic<int> runs{0};
+    const uint256 hash{m_rng.rand256()};
+
+    // Nothing was preloaded yet.
+    BOOST_CHECK(!preloader.Take(hash));
+
+    // Preloading the same block again does not restart its job.
+    preloader.Preload(hash, MakeJob(runs, /*wait_for_interrupt=*/false));
+    preloader.Preload(hash, MakeJob(runs, /*wait_for_interrupt=*/false));
+    BOOST_CHECK(!preloader.Take(m_rng.rand256()));
+    const auto result{preloader.Take(hash)};
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(result->block);
+    BOOST_CHECK_EQUAL(runs, 1);
+
+    // A block can only be taken once.
+    BOOST_CHECK(!preloader.Take(hash));
+}
+
+BOOST_AUTO_TEST_CASE(take_interrupts)
+{
+    BlockPreloader preloader{/*enabled=*/true};
+    std::atomic<int> runs{0};
+    const uint256 hash{m_rng.rand256()};
+    // The job only returns once interrupted, which Take must do.
+    preloader.Preload(hash, MakeJob(runs, /*wait_for_interrupt=*/true));
+    const auto result{preloader.Take(hash)};
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(result->block);
+    BOOST_CHECK_EQUAL(runs, 1);
+}
+
+BOOST_AUTO_TEST_CASE(preload_abandons_previous)
+{
+    BlockPreloader preloader{/*enabled=*/true};
+    std::atomic<int> runs{0};
+    const uint256 first{m_rng.rand256()};
+    const uint256 second{m_rng.rand256()};
+    preloader.Preload(first, MakeJob(runs, /*wait_for_interrupt=*/true));
+    preloader.Preload(second, MakeJob(runs, /*wait_for_interrupt=*/false));
+    BOOST_CHECK(!preloader.Take(first));
+    BOOST_CHECK(preloader.Take(second));
+
+    // A cancelled job cannot be taken, and the preloader can be reused afterwards.
+    preloader.Preload(first, MakeJob(runs, /*wait_for_interrupt=*/true));
+    preloader.Cancel();
+    BOOST_CHECK(!preloader.Take(first));
+    preloader.Preload(first, MakeJob(runs, /*wait_for_interrupt=*/false));
+    BOOST_CHECK(preloader.Take(first));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(blockpreloader_chain_tests, TestChain100Setup)
+
+//! Reconnect several blocks spending outputs from the coins database, so that
+//! each but the first is preloaded while its predecessor is being connected.
+BOOST_AUTO_TEST_CASE(reconnect_preloaded_blocks)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    BOOST_REQUIRE(m_node.chainman->GetBlockPreloader().IsEnabled());
+
+    constexpr int NUM_BLOCKS{5};
+    std::vector<COutPoint> spent;
+    for (int i{0}; i < NUM_BLOCKS; ++i) {
+        const auto tx{CreateValidMempoolTransaction(m_coinbase_txns[i], /*input_vout=*/0, /*input_height=*/i + 1,
+                                                    coinbaseKey, CScript() << OP_TRUE, /*output_amount=*/COIN, /*submit=*/false)};
+        spent.emplace_back(m_coinbase_txns[i]->GetHash(), 0);
+        CreateAndProcessBlock({tx}, CScript() << OP_TRUE);
+    }
+    CBlockIndex* tip{WITH_LOCK(::cs_main, return chainstate.m_chain.Tip())};
+    CBlockIndex* fork{WITH_LOCK(::cs_main, return tip->GetAncestor(tip->nHeight - NUM_BLOCKS + 1))};
+
+    BlockValidationState state;
+    BOOST_REQUIRE(chainstate.InvalidateBlock(state, fork));
+    // Write the restored coins to the database and empty the cache, so that
+    // they are read from the database again when reconnecting.
+    chainstate.ForceFlushStateToDisk();
+    for (const auto& outpoint : spent) {
+        LOCK(::cs_main);
+        BOOST_CHECK(!chainstate.CoinsTip().HaveCoinInCache(outpoint));
+        BOOST_CHECK(chainstate.CoinsDB().HaveCoin(outpoint));
+    }
+
+    WITH_LOCK(::cs_main, chainstate.ResetBlockFailureFlags(fork));
+    BOOST_REQUIRE(chainstate.ActivateBestChain(state));
+    BOOST_CHECK(state.IsValid());
+
+    LOCK(::cs_main);
+    BOOST_CHECK_EQUAL(chainstate.m_chain.Tip(), tip);
+    for (const auto& outpoint : spent) {
+        BOOST_CHECK(!chainstate.CoinsTip().HaveCoin(outpoint));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
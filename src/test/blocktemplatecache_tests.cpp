@@ -0,0 +1,206 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <consensus/amount.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <node/miner.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <script/solver.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using node::BlockAssembler;
+using node::BlockTemplateCache;
+using node::CBlockTemplate;
+
+namespace {
+struct BlockTemplateCacheSetup : public TestChain100Setup {
+    //! Long enough for the template to never be rebuilt because it is stale.
+    static constexpr std::chrono::hours REBUILD_INTERVAL{1};
+
+    BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, BlockAssembler::Options{}, REBUILD_INTERVAL};
+
+    BlockTemplateCacheSetup()
+    {
+        // Let the second coinbase output mature too.
+        CreateAndProcessBlock({}, CScript() << OP_TRUE);
+        m_node.validation_signals->RegisterValidationInterface(&cache);
+    }
+    ~BlockTemplateCacheSetup()
+    {
+        m_node.validation_signals->SyncWithValidationInterfaceQueue();
+        m_node.validation_signals->UnregisterValidationInterface(&cache);
+    }
+
+    std::unique_ptr<CBlockTemplate> GetTemplate(const CScript& script)
+    {
+        m_node.validation_signals->SyncWithValidationInterfaceQueue();
+        return cache.GetTemplate(script);
+    }
+
+    static bool Contains(const CBlock& block, const CTransaction& tx)
+    {
+        return std::any_of(block.vtx.begin(), block.vtx.end(), [&](const auto& block_tx) { return block_tx->GetHash() == tx.GetHash(); });
+    }
+
+    //! Check the template is a valid block on top of the tip, paying the subsidy and the fees of its transactions.
+    void CheckTemplate(const CBlockTemplate& block_template, const CScript& script)
+    {
+        const CBlock& block{block_template.block};
+        BOOST_REQUIRE_EQUAL(block.vtx.size(), block_template.vTxFees.size());
+        BOOST_REQUIRE_EQUAL(block.vtx.size(), block_template.vTxSigOpsCost.size());
+        BOOST_CHECK(block.vtx[0]->vout[0].scriptPubKey == script);
+
+        LOCK(::cs_main);
+        CBlockIndex* tip{m_node.chainman->ActiveChain().Tip()};
+        BOOST_CHECK_EQUAL(block.hashPrevBlock, tip->GetBlockHash());
+        CAmount fees{0};
+        for (size_t i{1}; i < block.vtx.size(); ++i) fees += block_template.vTxFees[i];
+        BOOST_CHECK_EQUAL(block_template.vTxFees[0], -fees);
+        BOOST_CHECK_EQUAL(block.vtx[0]->GetValueOut(), fees + GetBlockSubsidy(tip->nHeight + 1, m_node.chainman->GetConsensus()));
+
+        BlockValidationState state;
+        BOOST_CHECK_MESSAGE(TestBlockValidity(state, m_node.chainman->GetParams(), m_node.chainman->ActiveChainstate(), block, tip,
+                                              /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/false),
+                            state.ToString());
+    }
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blocktemplatecache_tests, BlockTemplateCacheSetup)
+
+BOOST_AUTO_TEST_CASE(follows_mempool_and_tip)
+{
+    const CScript script{CScript() << OP_TRUE};
+    const CScript p2pk{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+
+    auto block_template{GetTemplate(script)};
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+    CheckTemplate(*block_template, script);
+
+    // Transactions entering the mempool are appended, children after their parents.
+    const CTransactionRef parent{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1,
+                                                                                  coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    const CTransactionRef child{MakeTransactionRef(CreateValidMempoolTransaction(parent, /*input_vout=*/0, /*input_height=*/102,
+                                                                                 coinbaseKey, p2pk, /*output_amount=*/48 * COIN))};
+    const CTransactionRef other{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[1], /*input_vout=*/0, /*input_height=*/2,
+                                                                                 coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    block_template = GetTemplate(script);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 4U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[1]->GetHash(), parent->GetHash());
+    BOOST_CHECK_EQUAL(block_template->block.vtx[2]->GetHash(), child->GetHash());
+    BOOST_CHECK_EQUAL(block_template->block.vtx[3]->GetHash(), other->GetHash());
+    BOOST_CHECK_EQUAL(block_template->vTxFees[0], -3 * COIN);
+    CheckTemplate(*block_template, script);
+
+    // A transaction leaving the mempool is taken out along with what spends it.
+    WITH_LOCK(m_node.mempool->cs, m_node.mempool->removeRecursive(*parent, MemPoolRemovalReason::CONFLICT));
+    block_template = GetTemplate(script);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 2U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[1]->GetHash(), other->GetHash());
+    CheckTemplate(*block_template, script);
+
+    // Templates pay to the requested script.
+    const auto p2pk_template{GetTemplate(p2pk)};
+    CheckTemplate(*p2pk_template, p2pk);
+    BOOST_CHECK_EQUAL(p2pk_template->block.vtx.size(), 2U);
+
+    // The template is rebuilt on top of a new tip.
+    CreateAndProcessBlock({CMutableTransaction{*other}}, script);
+    block_template = GetTemplate(script);
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+    CheckTemplate(*block_template, script);
+    const CTransactionRef next{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[2], /*input_vout=*/0, /*input_height=*/3,
+                                                                                coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    block_template = GetTemplate(script);
+    BOOST_CHECK(Contains(block_template->block, *next));
+    CheckTemplate(*block_template, script);
+}
+
+BOOST_AUTO_TEST_CASE(rebuilds_when_stale)
+{
+    // Leave room for a single transaction in the block.
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = options.coinbase_max_additional_weight + 1000;
+    BlockTemplateCache lazy_cache{*m_node.chainman, *m_node.mempool, options, REBUILD_INTERVAL};
+    BlockTemplateCache eager_cache{*m_node.chainman, *m_node.mempool, options, /*rebuild_interval=*/std::chrono::milliseconds{0}};
+    m_node.validation_signals->RegisterValidationInterface(&lazy_cache);
+    m_node.validation_signals->RegisterValidationInterface(&eager_cache);
+
+    // Build both templates before the transactions arrive.
+    const CScript script{CScript() << OP_TRUE};
+    lazy_cache.GetTemplate(script);
+    eager_cache.GetTemplate(script);
+
+    const CScript p2pk{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    const CTransactionRef low{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1,
+                                                                               coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    const CTransactionRef high{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[1], /*input_vout=*/0, /*input_height=*/2,
+                                                                                coinbaseKey, p2pk, /*output_amount=*/48 * COIN))};
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+
+    // The second transaction did not fit, which made both templates stale,
+    // but only one of them could be rebuilt since.
+    const auto lazy_template{lazy_cache.GetTemplate(script)};
+    BOOST_REQUIRE_EQUAL(lazy_template->block.vtx.size(), 2U);
+    BOOST_CHECK_EQUAL(lazy_template->block.vtx[1]->GetHash(), low->GetHash());
+    CheckTemplate(*lazy_template, script);
+    const auto eager_template{eager_cache.GetTemplate(script)};
+    BOOST_REQUIRE_EQUAL(eager_template->block.vtx.size(), 2U);
+    BOOST_CHECK_EQUAL(eager_template->block.vtx[1]->GetHash(), high->GetHash());
+    CheckTemplate(*eager_template, script);
+
+    m_node.validation_signals->UnregisterValidationInterface(&eager_cache);
+    m_node.validation_signals->UnregisterValidationInterface(&lazy_cache);
+}
+
+BOOST_AUTO_TEST_CASE(invalidated_on_prioritisation)
+{
+    // Leave room for a single transaction in the block.
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = options.coinbase_max_additional_weight + 1000;
+    BlockTemplateCache small_cache{*m_node.chainman, *m_node.mempool, options, REBUILD_INTERVAL};
+    m_node.validation_signals->RegisterValidationInterface(&small_cache);
+
+    const CScript script{CScript() << OP_TRUE};
+    const CScript p2pk{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    const CTransactionRef high{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1,
+                                                                                coinbaseKey, p2pk, /*output_amount=*/48 * COIN))};
+    const CTransactionRef low{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[1], /*input_vout=*/0, /*input_height=*/2,
+                                                                               coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+
+    // Requested with cs_main held, like getblocktemplate does.
+    auto block_template{WITH_LOCK(::cs_main, return small_cache.GetTemplate(script))};
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 2U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[1]->GetHash(), high->GetHash());
+
+    // Prioritisation is not notified, so it is only taken into account once
+    // the template is invalidated.
+    m_node.mempool->PrioritiseTransaction(low->GetHash(), 2 * COIN);
+    BOOST_CHECK_EQUAL(small_cache.GetTemplate(script)->block.vtx[1]->GetHash(), high->GetHash());
+    small_cache.Invalidate();
+    block_template = small_cache.GetTemplate(script);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 2U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[1]->GetHash(), low->GetHash());
+    CheckTemplate(*block_template, script);
+
+    m_node.validation_signals->UnregisterValidationInterface(&small_cache);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,7 +14,10 @@
 #include <undo.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -81,16 +84,19 @@ public:
 class CCoinsViewCacheTest : public CCoinsViewCache
 {
 public:
-    explicit CCoinsViewCacheTest(CCoinsView* _base) : CCoinsViewCache(_base) {}
+    explicit CCoinsViewCacheTest(CCoinsView* _base, size_t num_shards = 1) : CCoinsViewCache(_base, /*deterministic=*/false, num_shards) {}
 
     void SelfTest(bool sanity_check = true) const
     {
         // Manually recompute the dynamic usage of the whole data, and compare it.
-        size_t ret = memusage::DynamicUsage(cacheCoins);
+        size_t ret = 0;
         size_t count = 0;
-        for (const auto& entry : cacheCoins) {
-            ret += entry.second.coin.DynamicMemoryUsage();
-            ++count;
+        for (const auto& shard : m_shards) {
+            ret += memusage::DynamicUsage(shard->m_map);
+            for (const auto& entry : shard->m_map) {
+                ret += entry.second.coin.DynamicMemoryUsage();
+                ++count;
+            }
         }
         BOOST_CHECK_EQUAL(GetCacheSize(), count);
         BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
@@ -99,9 +105,10 @@ public:
         }
     }
 
-    CCoinsMap& map() const { return cacheCoins; }
-    CoinsCachePair& sentinel() const { return m_sentinel; }
-    size_t& usage() const { return cachedCoinsUsage; }
+    // Direct access to the internals is only supported for unsharded caches.
+    CCoinsMap& map() const { assert(m_shards.size() == 1); return m_shards[0]->m_map; }
+    CoinsCachePair& sentinel() const { assert(m_shards.size() == 1); return m_shards[0]->m_sentinel; }
+    size_t& usage() const { assert(m_shards.size() == 1); return m_shards[0]->m_usage; }
 };
 
 } // namespace
@@ -125,7 +132,9 @@ struct CacheTest : BasicTestingSetup {
 // of best block on flush. This is necessary when using CCoinsViewDB as the base,
 // otherwise we'll hit an assertion in BatchWrite.
 //
-void SimulationTest(CCoinsView* base, bool fake_best_block)
+// Caches created directly on top of the base are split into num_shards shards.
+//
+void SimulationTest(CCoinsView* base, bool fake_best_block, size_t num_shards = 1)
 {
     // Various coverage trackers.
     bool removed_all_caches = false;
@@ -138,13 +147,14 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
     bool missed_an_entry = false;
     bool uncached_an_entry = false;
     bool flushed_without_erase = false;
+    bool flushed_with_eviction = false;
 
     // A simple map to track what we expect the cache stack to represent.
     std::map<COutPoint, Coin> result;
 
     // The cache stack.
     std::vector<std::unique_ptr<CCoinsViewCacheTest>> stack; // A stack of CCoinsViewCaches on top.
-    stack.push_back(std::make_unique<CCoinsViewCacheTest>(base)); // Start with one cache.
+    stack.push_back(std::make_unique<CCoinsViewCacheTest>(base, num_shards)); // Start with one cache.
 
     // Use a limited set of random transaction ids, so we do test overwriting entries.
     std::vector<Txid> txids;
@@ -241,7 +251,14 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
                 unsigned int flushIndex = m_rng.randrange(stack.size() - 1);
                 if (fake_best_block) stack[flushIndex]->SetBestBlock(m_rng.rand256());
                 bool should_erase = m_rng.randrange(4) < 3;
-                BOOST_CHECK(should_erase ? stack[flushIndex]->Flush() : stack[flushIndex]->Sync());
+                if (should_erase) {
+                    BOOST_CHECK(stack[flushIndex]->Flush());
+                } else if (m_rng.randbool()) {
+                    BOOST_CHECK(stack[flushIndex]->SyncAndEvict(m_rng.randrange(stack[flushIndex]->DynamicMemoryUsage() + 1)));
+                    flushed_with_eviction = true;
+                } else {
+                    BOOST_CHECK(stack[flushIndex]->Sync());
+                }
                 flushed_without_erase |= !should_erase;
             }
         }
@@ -263,7 +280,7 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
                 } else {
                     removed_all_caches = true;
                 }
-                stack.push_back(std::make_unique<CCoinsViewCacheTest>(tip));
+                stack.push_back(std::make_unique<CCoinsViewCacheTest>(tip, tip == base ? num_shards : 1));
                 if (stack.size() == 4) {
                     reached_4_caches = true;
                 }
@@ -282,6 +299,7 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
     BOOST_CHECK(missed_an_entry);
     BOOST_CHECK(uncached_an_entry);
     BOOST_CHECK(flushed_without_erase);
+    BOOST_CHECK(flushed_with_eviction);
 }
 }; // struct CacheTest
 
@@ -293,6 +311,69 @@ BOOST_FIXTURE_TEST_CASE(coins_cache_simulation_test, CacheTest)
 
     CCoinsViewDB db_base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
     SimulationTest(&db_base, true);
+
+    CCoinsViewDB background_db_base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.background_flush = true}};
+    SimulationTest(&background_db_base, true);
+
+    CCoinsViewTest sharded_base{m_rng};
+    SimulationTest(&sharded_base, false, /*num_shards=*/4);
+}
+
+// Read a sharded cache through PeekCoin from several threads while it is
+// being modified and flushed, as done for the chainstate's cache.
+BOOST_AUTO_TEST_CASE(coins_cache_concurrent_peek)
+{
+    constexpr int NUM_OUTPOINTS{2000};
+    constexpr int NUM_READERS{3};
+    // Every coin ever added for an outpoint has the same value, so readers can
+    // check what they see without synchronizing with the writer.
+    const auto value_of{[](const COutPoint& outpoint) { return CAmount(outpoint.n + 1); }};
+
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 20, .memory_only = true}, {}};
+    CCoinsViewCacheTest cache{&db, /*num_shards=*/8};
+    BOOST_CHECK_EQUAL(cache.GetShardCount(), 8U);
+    const Txid txid{Txid::FromUint256(m_rng.rand256())};
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> found{0};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int i{0}; i < NUM_READERS; ++i) {
+        readers.emplace_back([&] {
+            FastRandomContext rng;
+            while (!stop) {
+                const COutPoint outpoint{txid, uint32_t(rng.randrange(NUM_OUTPOINTS))};
+                if (const auto coin{cache.PeekCoin(outpoint)}) {
+                    if (coin->out.nValue != value_of(outpoint)) ++mismatches;
+                    ++found;
+                }
+            }
+        });
+    }
+
+    for (int i{0}; i < 20'000 || found == 0; ++i) {
+        const COutPoint outpoint{txid, uint32_t(m_rng.randrange(NUM_OUTPOINTS))};
+        if (cache.HaveCoin(outpoint)) {
+            BOOST_CHECK(cache.SpendCoin(outpoint));
+        } else {
+            cache.AddCoin(outpoint, Coin{CTxOut{value_of(outpoint), CScript() << OP_TRUE}, 1, false}, /*possible_overwrite=*/false);
+        }
+        if (m_rng.randrange(1000) == 0) {
+            cache.SetBestBlock(m_rng.rand256());
+            BOOST_CHECK(m_rng.randbool() ? cache.Flush() : cache.Sync());
+        }
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    cache.SelfTest();
+
+    // Once the writer is done, readers see exactly what the owner sees.
+    for (uint32_t n{0}; n < NUM_OUTPOINTS; ++n) {
+        const COutPoint outpoint{txid, n};
+        const auto coin{cache.PeekCoin(outpoint)};
+        BOOST_CHECK_EQUAL(coin.has_value(), cache.HaveCoin(outpoint));
+    }
 }
 
 struct UpdateTest : BasicTestingSetup {
@@ -1098,6 +1179,159 @@ BOOST_FIXTURE_TEST_CASE(ccoins_flush_behavior, FlushTest)
         TestFlushBehavior(view.get(), base, caches, /*do_erasing_flush=*/false);
         TestFlushBehavior(view.get(), base, caches, /*do_erasing_flush=*/true);
     }
+
+    // The same, with the database written in the background.
+    CCoinsViewDB background_base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.background_flush = true}};
+    std::vector<std::unique_ptr<CCoinsViewCacheTest>> background_caches;
+    background_caches.push_back(std::make_unique<CCoinsViewCacheTest>(&background_base));
+    background_caches.push_back(std::make_unique<CCoinsViewCacheTest>(background_caches.back().get()));
+
+    for (const auto& view : background_caches) {
+        TestFlushBehavior(view.get(), background_base, background_caches, /*do_erasing_flush=*/false);
+        TestFlushBehavior(view.get(), background_base, background_caches, /*do_erasing_flush=*/true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync_and_evict)
+{
+    for (const size_t num_shards : {1, 4}) {
+        CCoinsViewTest base{m_rng};
+        CCoinsViewCacheTest cache{&base, num_shards};
+        const auto usage{[&] { return cache.DynamicMemoryUsage() - cache.ReusableMemoryUsage(); }};
+        const auto add_coins{[&](size_t count) {
+            std::vector<COutPoint> added;
+            for (uint32_t n{0}; n < count; ++n) {
+                added.emplace_back(Txid::FromUint256(m_rng.rand256()), n);
+                cache.AddCoin(added.back(), Coin{CTxOut{n + 1, CScript() << OP_TRUE}, 1, false}, /*possible_overwrite=*/false);
+            }
+            return added;
+        }};
+        // Count the evicted coins among the given ones. Without sharding, the
+        // eviction order is exact, so check that they are the first ones.
+        const auto count_evicted{[&](const std::vector<COutPoint>& oldest_first) {
+            size_t evicted{0};
+            for (const auto& outpoint : oldest_first) {
+                if (!cache.HaveCoinInCache(outpoint)) ++evicted;
+            }
+            if (num_shards == 1) {
+                for (size_t i{0}; i < oldest_first.size(); ++i) {
+                    BOOST_CHECK_EQUAL(cache.HaveCoinInCache(oldest_first[i]), i >= evicted);
+                }
+            }
+            return evicted;
+        }};
+
+        const auto base_has{[&](const COutPoint& outpoint) {
+            Coin coin;
+            return base.GetCoin(outpoint, coin) && !coin.IsSpent();
+        }};
+
+        // Coins are added in order, so the first ones were used longest ago.
+        const auto first{add_coins(20000)};
+        const size_t max_usage{usage() * 3 / 4};
+        cache.SetBestBlock(m_rng.rand256());
+        BOOST_CHECK(cache.SyncAndEvict(max_usage));
+        cache.SelfTest();
+
+        // Everything was written, and the cache shrunk to the requested size
+        // by evicting the oldest coins, whose memory can be reused.
+        BOOST_CHECK_LE(usage(), max_usage);
+        for (const auto& outpoint : first) BOOST_CHECK(base_has(outpoint));
+        const size_t evicted_first{count_evicted(first)};
+        BOOST_CHECK_GT(evicted_first, 0U);
+        BOOST_CHECK_LT(evicted_first, first.size() / 2);
+        if (num_shards > 1) {
+            const size_t evicted_first_half{count_evicted({first.begin(), first.begin() + first.size() / 2})};
+            BOOST_CHECK_GT(evicted_first_half, evicted_first * 4 / 5);
+        }
+
+        // In the next round, use the oldest coins left in the cache, load some
+        // evicted ones back from the base, spend the newest ones and add more.
+        // All of those are now more recently used than the other cached coins.
+        std::vector<COutPoint> survivors;
+        for (const auto& outpoint : first) {
+            if (cache.HaveCoinInCache(outpoint)) survivors.push_back(outpoint);
+        }
+        BOOST_REQUIRE_GT(survivors.size(), 3000U);
+        const std::vector<COutPoint> used(survivors.begin(), survivors.begin() + 1000);
+        const std::vector<COutPoint> loaded(first.begin(), first.begin() + 1000);
+        const std::vector<COutPoint> spent(survivors.end() - 1000, survivors.end());
+        const std::vector<COutPoint> untouched(survivors.begin() + 1000, survivors.end() - 1000);
+        for (const auto& outpoint : used) BOOST_CHECK(!cache.AccessCoin(outpoint).IsSpent());
+        for (const auto& outpoint : loaded) BOOST_CHECK(!cache.AccessCoin(outpoint).IsSpent());
+        for (const auto& outpoint : spent) BOOST_CHECK(cache.SpendCoin(outpoint));
+        const auto second{add_coins(3000)};
+        cache.SetBestBlock(m_rng.rand256());
+        BOOST_CHECK(cache.SyncAndEvict(max_usage));
+        cache.SelfTest();
+
+        // Only coins which were not used in this round were evicted, the
+        // oldest first, and the cache is back to the requested size.
+        BOOST_CHECK_LE(usage(), max_usage);
+        for (const auto& outpoint : spent) BOOST_CHECK(!base_has(outpoint));
+        for (const auto& outpoint : second) BOOST_CHECK(base_has(outpoint));
+        BOOST_CHECK_EQUAL(count_evicted(used), 0U);
+        BOOST_CHECK_EQUAL(count_evicted(loaded), 0U);
+        BOOST_CHECK_EQUAL(count_evicted(second), 0U);
+        BOOST_CHECK_GT(count_evicted(untouched), 0U);
+
+        // Without any use of the old coins, a third round evicts them before
+        // the new ones.
+        const auto third{add_coins(12000)};
+        cache.SetBestBlock(m_rng.rand256());
+        BOOST_CHECK(cache.SyncAndEvict(max_usage));
+        cache.SelfTest();
+        BOOST_CHECK_LE(usage(), max_usage);
+        BOOST_CHECK_EQUAL(count_evicted(third), 0U);
+        BOOST_CHECK_EQUAL(count_evicted(untouched), untouched.size());
+
+        for (const auto& outpoint : first) {
+            BOOST_CHECK_EQUAL(cache.HaveCoin(outpoint), std::find(spent.begin(), spent.end(), outpoint) == spent.end());
+        }
+        cache.SelfTest();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 20, .memory_only = true}, {.background_flush = true}};
+    CCoinsViewCacheTest cache{&db};
+    std::vector<COutPoint> outpoints;
+    for (uint32_t n{0}; n < 1000; ++n) {
+        outpoints.emplace_back(Txid::FromUint256(m_rng.rand256()), n);
+        cache.AddCoin(outpoints.back(), Coin{CTxOut{n + 1, CScript() << OP_TRUE}, 1, false}, /*possible_overwrite=*/false);
+    }
+    const uint256 first_block{m_rng.rand256()};
+    cache.SetBestBlock(first_block);
+    BOOST_CHECK(cache.Flush());
+
+    // Whether or not the write has completed yet, the database view reflects it.
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), first_block);
+    for (const auto& outpoint : outpoints) {
+        Coin coin;
+        BOOST_CHECK(db.GetCoin(outpoint, coin));
+        BOOST_CHECK_EQUAL(coin.out.nValue, CAmount(outpoint.n + 1));
+    }
+
+    // Spend half of the coins. Starting the next write waits for the previous one.
+    for (size_t i{0}; i < outpoints.size(); i += 2) {
+        BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+    }
+    const uint256 second_block{m_rng.rand256()};
+    cache.SetBestBlock(second_block);
+    BOOST_CHECK(cache.Sync());
+    for (size_t i{0}; i < outpoints.size(); ++i) {
+        BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), i % 2 == 1);
+    }
+
+    BOOST_CHECK(db.WaitForWrite());
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), second_block);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    for (size_t i{0}; i < outpoints.size(); ++i) {
+        BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), i % 2 == 1);
+        BOOST_CHECK_EQUAL(cache.HaveCoin(outpoints[i]), i % 2 == 1);
+    }
+    cache.SelfTest();
 }
 
 BOOST_AUTO_TEST_CASE(coins_resource_is_used)
@@ -0,0 +1,125 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <consensus/amount.h>
+#include <inputfetcher.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct InputFetcherTest : BasicTestingSetup {
+    CCoinsViewDB m_db{{.path = "test", .cache_bytes = 1 << 20, .memory_only = true}, {}};
+    CBlock m_block;
+
+    //! Outpoints of the block that were written to the database.
+    std::vector<COutPoint> m_db_outpoints;
+
+    Coin MakeCoin()
+    {
+        return Coin{CTxOut{m_rng.randrange(MAX_MONEY), CScript() << OP_0 << m_rng.randbytes(20)}, 1, /*fCoinBaseIn=*/false};
+    }
+
+    //! Create a block with num_txs transactions, each spending num_inputs
+    //! outputs from the database, and one spending an output of its predecessor.
+    void Setup(int num_txs, int num_inputs)
+    {
+        CCoinsViewCache cache{&m_db};
+        CMutableTransaction coinbase;
+        coinbase.vin.emplace_back();
+        coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+        m_block.vtx.push_back(MakeTransactionRef(coinbase));
+        for (int i{0}; i < num_txs; ++i) {
+            CMutableTransaction tx;
+            for (int j{0}; j < num_inputs; ++j) {
+                const COutPoint outpoint{Txid::FromUint256(m_rng.rand256()), uint32_t(j)};
+                cache.AddCoin(outpoint, MakeCoin(), /*possible_overwrite=*/false);
+                m_db_outpoints.push_back(outpoint);
+                tx.vin.emplace_back(outpoint);
+            }
+            // Intra-block spend, which must not be looked up.
+            tx.vin.emplace_back(COutPoint{m_block.vtx.back()->GetHash(), 0});
+            tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            m_block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        cache.SetBestBlock(m_rng.rand256());
+        BOOST_REQUIRE(cache.Flush());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(inputfetcher_tests, InputFetcherTest)
+
+BOOST_AUTO_TEST_CASE(fetch_inputs)
+{
+    Setup(/*num_txs=*/100, /*num_inputs=*/10);
+    InputFetcher fetcher{/*batch_size=*/4, /*worker_threads_num=*/3};
+    BOOST_REQUIRE(fetcher.HasThreads());
+
+    // Run several times to exercise reuse of the worker threads.
+    for (int run{0}; run < 3; ++run) {
+        CCoinsViewCache cache{&m_db};
+        const auto stats{fetcher.FetchInputs(cache, m_db, m_block)};
+        BOOST_CHECK_EQUAL(stats.inputs, m_db_outpoints.size());
+        BOOST_CHECK_EQUAL(stats.cache_hits, 0U);
+        BOOST_CHECK_EQUAL(stats.fetched, m_db_outpoints.size());
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), m_db_outpoints.size());
+        for (const auto& outpoint : m_db_outpoints) {
+            BOOST_CHECK(cache.HaveCoinInCache(outpoint));
+            Coin coin;
+            BOOST_REQUIRE(m_db.GetCoin(outpoint, coin));
+            BOOST_CHECK(cache.AccessCoin(outpoint).out == coin.out);
+        }
+        // Fetched entries are unflagged, so there is nothing to write back.
+        cache.SanityCheck();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fetch_inputs_partially_cached)
+{
+    Setup(/*num_txs=*/20, /*num_inputs=*/5);
+    InputFetcher fetcher{/*batch_size=*/1, /*worker_threads_num=*/2};
+
+    CCoinsViewCache cache{&m_db};
+    // Pull one coin into the cache, spend another one and make a third one missing.
+    BOOST_CHECK(cache.HaveCoin(m_db_outpoints[0]));
+    BOOST_CHECK(cache.SpendCoin(m_db_outpoints[1]));
+    {
+        CCoinsViewCache db_cache{&m_db};
+        BOOST_CHECK(db_cache.SpendCoin(m_db_outpoints[2]));
+        db_cache.SetBestBlock(m_rng.rand256());
+        BOOST_REQUIRE(db_cache.Flush());
+    }
+
+    const auto stats{fetcher.FetchInputs(cache, m_db, m_block)};
+    BOOST_CHECK_EQUAL(stats.inputs, m_db_outpoints.size());
+    BOOST_CHECK_EQUAL(stats.cache_hits, 1U);
+    BOOST_CHECK_EQUAL(stats.fetched, m_db_outpoints.size() - 3);
+    // The spent coin was not resurrected and the missing one was not added.
+    BOOST_CHECK(!cache.HaveCoinInCache(m_db_outpoints[1]));
+    BOOST_CHECK(!cache.HaveCoinInCache(m_db_outpoints[2]));
+    cache.SanityCheck();
+}
+
+BOOST_AUTO_TEST_CASE(fetch_inputs_no_threads)
+{
+    Setup(/*num_txs=*/5, /*num_inputs=*/2);
+    InputFetcher fetcher{/*batch_size=*/1, /*worker_threads_num=*/0};
+    BOOST_CHECK(!fetcher.HasThreads());
+
+    CCoinsViewCache cache{&m_db};
+    const auto stats{fetcher.FetchInputs(cache, m_db, m_block)};
+    BOOST_CHECK_EQUAL(stats.inputs, 0U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
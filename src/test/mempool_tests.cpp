@@ -7,10 +7,12 @@
 #include <test/util/txmempool.h>
 #include <txmempool.h>
 #include <util/time.h>
+#include <util/translation.h>
 
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+#include <numeric>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -804,4 +806,209 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockTest)
+{
+    size_t ancestors, descendants, ancestor_size;
+    CAmount ancestor_fees;
+
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [ta].0 <- [tb].0 -----<------- [td].0 <- [te]
+    //            |                    |
+    //            \---1 <- [tc].0 --<--/
+    const CTransactionRef ta{make_tx(/*output_values=*/{10 * COIN})};
+    const CTransactionRef tb{make_tx(/*output_values=*/{5 * COIN, 3 * COIN}, /*inputs=*/{ta})};
+    const CTransactionRef tc{make_tx(/*output_values=*/{2 * COIN}, /*inputs=*/{tb}, /*input_indices=*/{1})};
+    const CTransactionRef td{make_tx(/*output_values=*/{6 * COIN}, /*inputs=*/{tb, tc}, /*input_indices=*/{0, 0})};
+    const CTransactionRef te{make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{td})};
+    const auto add_all{[&] {
+        CAmount fee{1000};
+        for (const auto& tx : {ta, tb, tc, td, te}) {
+            pool.addUnchecked(entry.Fee(fee).FromTx(tx));
+            fee += 1000;
+        }
+    }};
+    const auto size{[](const CTransactionRef& tx) { return size_t(GetVirtualTransactionSize(*tx)); }};
+    const auto descendant_count{[&](const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+        return pool.GetIter(tx->GetHash()).value()->GetCountWithDescendants();
+    }};
+
+    // Mining the first two transactions leaves tc at the top of the cluster.
+    add_all();
+    pool.removeForBlock({ta, tb}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    pool.GetTransactionAncestry(tc->GetHash(), ancestors, descendants, &ancestor_size, &ancestor_fees);
+    BOOST_CHECK_EQUAL(ancestors, 1U);
+    BOOST_CHECK_EQUAL(descendant_count(tc), 3U);
+    BOOST_CHECK_EQUAL(ancestor_size, size(tc));
+    BOOST_CHECK_EQUAL(ancestor_fees, 3000);
+    pool.GetTransactionAncestry(td->GetHash(), ancestors, descendants, &ancestor_size, &ancestor_fees);
+    BOOST_CHECK_EQUAL(ancestors, 2U);
+    BOOST_CHECK_EQUAL(descendant_count(td), 2U);
+    BOOST_CHECK_EQUAL(ancestor_size, size(tc) + size(td));
+    BOOST_CHECK_EQUAL(ancestor_fees, 7000);
+    pool.GetTransactionAncestry(te->GetHash(), ancestors, descendants, &ancestor_size, &ancestor_fees);
+    BOOST_CHECK_EQUAL(ancestors, 3U);
+    BOOST_CHECK_EQUAL(descendant_count(te), 1U);
+    BOOST_CHECK_EQUAL(ancestor_size, size(tc) + size(td) + size(te));
+    BOOST_CHECK_EQUAL(ancestor_fees, 12000);
+    BOOST_CHECK(pool.GetIter(tc->GetHash()).value()->GetMemPoolParentsConst().empty());
+    BOOST_CHECK_EQUAL(pool.GetIter(td->GetHash()).value()->GetMemPoolParentsConst().size(), 1U);
+
+    // Ancestors left in the mempool of a mined transaction no longer count it
+    // as a descendant.
+    pool.removeRecursive(*tc, REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+    add_all();
+    pool.removeForBlock({tc}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.size(), 4U);
+    pool.GetTransactionAncestry(ta->GetHash(), ancestors, descendants);
+    BOOST_CHECK_EQUAL(ancestors, 1U);
+    BOOST_CHECK_EQUAL(descendant_count(ta), 4U);
+    pool.GetTransactionAncestry(tb->GetHash(), ancestors, descendants);
+    BOOST_CHECK_EQUAL(ancestors, 2U);
+    BOOST_CHECK_EQUAL(descendant_count(tb), 3U);
+    pool.GetTransactionAncestry(te->GetHash(), ancestors, descendants, &ancestor_size, &ancestor_fees);
+    BOOST_CHECK_EQUAL(ancestors, 4U);
+    BOOST_CHECK_EQUAL(descendant_count(te), 1U);
+    BOOST_CHECK_EQUAL(ancestor_size, size(ta) + size(tb) + size(td) + size(te));
+    BOOST_CHECK_EQUAL(ancestor_fees, 12000);
+
+    // Including when the mined transactions form a chain below the one left.
+    pool.removeRecursive(*ta, REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+    add_all();
+    pool.removeForBlock({tb, tc}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    const auto ta_it{pool.GetIter(ta->GetHash()).value()};
+    BOOST_CHECK_EQUAL(ta_it->GetCountWithDescendants(), 1U);
+    BOOST_CHECK_EQUAL(ta_it->GetSizeWithDescendants(), int64_t(size(ta)));
+    BOOST_CHECK_EQUAL(ta_it->GetModFeesWithDescendants(), 1000);
+    BOOST_CHECK(ta_it->GetMemPoolChildrenConst().empty());
+    BOOST_CHECK_EQUAL(descendant_count(td), 2U);
+    pool.GetTransactionAncestry(te->GetHash(), ancestors, descendants, &ancestor_size, &ancestor_fees);
+    BOOST_CHECK_EQUAL(ancestors, 2U);
+    BOOST_CHECK_EQUAL(ancestor_size, size(td) + size(te));
+    BOOST_CHECK_EQUAL(ancestor_fees, 9000);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolClusterLinearizationTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [ta] <- [tb] <- [td], [tc] on its own
+    const CTransactionRef ta{make_tx(/*output_values=*/{10 * COIN})};
+    const CTransactionRef tb{make_tx(/*output_values=*/{9 * COIN}, /*inputs=*/{ta})};
+    const CTransactionRef tc{make_tx(/*output_values=*/{8 * COIN})};
+    const CTransactionRef td{make_tx(/*output_values=*/{7 * COIN}, /*inputs=*/{tb})};
+    pool.addUnchecked(entry.Fee(1000).FromTx(ta));
+    pool.addUnchecked(entry.Fee(10000).FromTx(tb));
+    pool.addUnchecked(entry.Fee(500).FromTx(tc));
+    const auto size{[](const CTransactionRef& tx) { return int32_t(GetVirtualTransactionSize(*tx)); }};
+    const auto iter{[&](const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) { return pool.GetIter(tx->GetHash()).value(); }};
+
+    // The child pays for its parent, so both form a single chunk.
+    const auto lin_ab{pool.GetClusterLinearization(iter(ta))};
+    BOOST_REQUIRE(lin_ab);
+    BOOST_CHECK(lin_ab->optimal);
+    BOOST_CHECK(lin_ab->txs == (std::vector{iter(ta), iter(tb)}));
+    BOOST_CHECK(lin_ab->chunks == (std::vector{FeeFrac{11000, size(ta) + size(tb)}}));
+    // Every member of the cluster shares the cached linearization.
+    BOOST_CHECK_EQUAL(pool.GetClusterLinearization(iter(tb)), lin_ab);
+    const auto lin_c{pool.GetClusterLinearization(iter(tc))};
+    BOOST_REQUIRE(lin_c);
+    BOOST_CHECK(lin_c->txs == (std::vector{iter(tc)}));
+    BOOST_CHECK(lin_c->chunks == (std::vector{FeeFrac{500, size(tc)}}));
+
+    // Adding a low feerate child to the cluster gives it a chunk of its own,
+    // and leaves other clusters cached.
+    pool.addUnchecked(entry.Fee(100).FromTx(td));
+    const auto lin_abd{pool.GetClusterLinearization(iter(td))};
+    BOOST_REQUIRE(lin_abd);
+    BOOST_CHECK(lin_abd != lin_ab);
+    BOOST_CHECK_EQUAL(pool.GetClusterLinearization(iter(ta)), lin_abd);
+    BOOST_CHECK(lin_abd->txs == (std::vector{iter(ta), iter(tb), iter(td)}));
+    BOOST_CHECK(lin_abd->chunks == (std::vector{FeeFrac{11000, size(ta) + size(tb)}, FeeFrac{100, size(td)}}));
+    BOOST_CHECK_EQUAL(pool.GetClusterLinearization(iter(tc)), lin_c);
+
+    // Prioritising it merges it into the chunk of its ancestors.
+    pool.PrioritiseTransaction(td->GetHash(), 100000);
+    const auto lin_prioritised{pool.GetClusterLinearization(iter(tb))};
+    BOOST_REQUIRE(lin_prioritised);
+    BOOST_CHECK(lin_prioritised != lin_abd);
+    BOOST_CHECK(lin_prioritised->chunks == (std::vector{FeeFrac{111100, size(ta) + size(tb) + size(td)}}));
+
+    // Removing it splits the cluster again.
+    pool.removeRecursive(*td, REMOVAL_REASON_DUMMY);
+    const auto lin_removed{pool.GetClusterLinearization(iter(ta))};
+    BOOST_REQUIRE(lin_removed);
+    BOOST_CHECK(lin_removed != lin_prioritised);
+    BOOST_CHECK(lin_removed->txs == (std::vector{iter(ta), iter(tb)}));
+    BOOST_CHECK(lin_removed->chunks == lin_ab->chunks);
+    BOOST_CHECK_EQUAL(pool.GetClusterLinearization(iter(tc)), lin_c);
+
+    // Clusters too large to linearize are not cached.
+    std::vector<CTransactionRef> chain{tc};
+    for (unsigned i{0}; i < CTxMemPool::MAX_CLUSTER_LINEARIZATION_COUNT; ++i) {
+        chain.push_back(make_tx(/*output_values=*/{COIN}, /*inputs=*/{chain.back()}));
+        pool.addUnchecked(entry.Fee(1000).FromTx(chain.back()));
+    }
+    BOOST_CHECK(!pool.GetClusterLinearization(iter(tc)));
+    BOOST_CHECK(!pool.GetClusterLinearization(iter(chain.back())));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolLinearizeClustersTest)
+{
+    auto opts{MemPoolOptionsForTest(m_node)};
+    opts.linearization_threads = 2;
+    bilingual_str error;
+    CTxMemPool pool{opts, error};
+    BOOST_REQUIRE(error.empty());
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // Ten clusters of a parent with a high and a low feerate child.
+    constexpr unsigned NUM_CLUSTERS{10};
+    std::vector<CTransactionRef> parents, high_children, low_children;
+    std::vector<CTxMemPool::txiter> txs;
+    for (unsigned i{0}; i < NUM_CLUSTERS; ++i) {
+        parents.push_back(make_tx(/*output_values=*/{COIN, COIN + i}));
+        high_children.push_back(make_tx(/*output_values=*/{COIN}, /*inputs=*/{parents.back()}, /*input_indices=*/{0}));
+        low_children.push_back(make_tx(/*output_values=*/{COIN}, /*inputs=*/{parents.back()}, /*input_indices=*/{1}));
+        pool.addUnchecked(entry.Fee(1000).FromTx(parents.back()));
+        pool.addUnchecked(entry.Fee(5000).FromTx(high_children.back()));
+        pool.addUnchecked(entry.Fee(100).FromTx(low_children.back()));
+        txs.push_back(pool.GetIter(low_children.back()->GetHash()).value());
+    }
+    const auto size{[](const CTransactionRef& tx) { return int32_t(GetVirtualTransactionSize(*tx)); }};
+    const auto iter{[&](const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) { return pool.GetIter(tx->GetHash()).value(); }};
+
+    // All clusters are linearized at once, and only once.
+    BOOST_CHECK_EQUAL(pool.LinearizeClusters(txs, CTxMemPool::BLOCK_LINEARIZATION_ITERATIONS), NUM_CLUSTERS);
+    BOOST_CHECK_EQUAL(pool.LinearizeClusters(txs, CTxMemPool::BLOCK_LINEARIZATION_ITERATIONS), 0U);
+    for (unsigned i{0}; i < NUM_CLUSTERS; ++i) {
+        const auto lin{pool.GetClusterLinearization(iter(parents[i]))};
+        BOOST_REQUIRE(lin);
+        BOOST_CHECK(lin->optimal);
+        BOOST_CHECK(lin->txs == (std::vector{iter(parents[i]), iter(high_children[i]), iter(low_children[i])}));
+        BOOST_CHECK(lin->chunks == (std::vector{FeeFrac{6000, size(parents[i]) + size(high_children[i])}, FeeFrac{100, size(low_children[i])}}));
+    }
+    BOOST_CHECK_EQUAL(pool.ImproveClusterLinearizations(CTxMemPool::IDLE_LINEARIZATION_ITERATIONS), 0U);
+
+    // A cluster linearized without any iterations is not known to be optimal
+    // until it is improved.
+    pool.PrioritiseTransaction(low_children[0]->GetHash(), 10000);
+    BOOST_CHECK_EQUAL(pool.LinearizeClusters({iter(parents[0])}, /*max_iterations=*/0), 1U);
+    BOOST_CHECK(!pool.GetClusterLinearization(iter(parents[0]))->optimal);
+    BOOST_CHECK_EQUAL(pool.ImproveClusterLinearizations(CTxMemPool::IDLE_LINEARIZATION_ITERATIONS), 1U);
+    const auto improved{pool.GetClusterLinearization(iter(parents[0]))};
+    BOOST_CHECK(improved->optimal);
+    BOOST_CHECK(std::accumulate(improved->chunks.begin(), improved->chunks.end(), FeeFrac{}) ==
+                (FeeFrac{16100, size(parents[0]) + size(high_children[0]) + size(low_children[0])}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
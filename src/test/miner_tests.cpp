@@ -8,8 +8,10 @@
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
+#include <interfaces/mining.h>
 #include <node/miner.h>
 #include <policy/policy.h>
+#include <script/solver.h>
 #include <test/util/random.h>
 #include <test/util/txmempool.h>
 #include <txmempool.h>
@@ -659,4 +661,42 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     TestPrioritisedMining(scriptPubKey, txFirst);
 }
 
+BOOST_FIXTURE_TEST_CASE(wait_next, TestChain100Setup)
+{
+    auto mining{interfaces::MakeMining(m_node)};
+    const CScript script{CScript() << OP_TRUE};
+    const auto block_template{mining->createNewBlock(script)};
+    BOOST_CHECK(block_template->getAddedTransactions().empty());
+    BOOST_CHECK(block_template->getRemovedTransactions().empty());
+
+    // Nothing changed.
+    const node::BlockWaitOptions no_fee_check{.timeout = MillisecondsDouble{10}};
+    BOOST_CHECK(!block_template->waitNext(no_fee_check));
+    const node::BlockWaitOptions fee_check{.timeout = MillisecondsDouble{10}, .fee_threshold = COIN};
+    BOOST_CHECK(!block_template->waitNext(fee_check));
+
+    // A new transaction only yields a template if its fee is high enough.
+    const CScript p2pk{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    const CTransactionRef tx{MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1,
+                                                                              coinbaseKey, p2pk, /*output_amount=*/49 * COIN))};
+    BOOST_CHECK(!block_template->waitNext(no_fee_check));
+    BOOST_CHECK(!block_template->waitNext({.timeout = MillisecondsDouble{10}, .fee_threshold = COIN + 1}));
+    const auto with_tx{block_template->waitNext(fee_check)};
+    BOOST_REQUIRE(with_tx);
+    BOOST_CHECK_EQUAL(with_tx->getBlockHeader().hashPrevBlock, block_template->getBlockHeader().hashPrevBlock);
+    BOOST_CHECK(with_tx->getCoinbaseTx()->vout[0].scriptPubKey == script);
+    const auto added{with_tx->getAddedTransactions()};
+    BOOST_REQUIRE_EQUAL(added.size(), 1U);
+    BOOST_CHECK_EQUAL(added[0]->GetHash(), tx->GetHash());
+    BOOST_CHECK(with_tx->getRemovedTransactions().empty());
+
+    // A new tip always yields a template.
+    CreateAndProcessBlock({CMutableTransaction{*tx}}, script);
+    const auto next{with_tx->waitNext(no_fee_check)};
+    BOOST_REQUIRE(next);
+    BOOST_CHECK_EQUAL(next->getBlockHeader().hashPrevBlock, WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()));
+    BOOST_CHECK(next->getAddedTransactions().empty());
+    BOOST_CHECK(next->getRemovedTransactions() == std::vector<Txid>{tx->GetHash()});
+}
+
 BOOST_AUTO_TEST_SUITE_END()
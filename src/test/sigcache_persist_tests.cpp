@@ -0,0 +1,113 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <node/sigcache_persist.h>
+#include <pubkey.h>
+#include <script/sigcache.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/fs.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using node::DumpSigCache;
+using node::LoadSigCache;
+
+static constexpr size_t CACHE_BYTES{1 << 20};
+
+BOOST_FIXTURE_TEST_SUITE(sigcache_persist_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dump_and_load)
+{
+    LOCK(::cs_main);
+    const fs::path path{m_args.GetDataDirNet() / "sigcache.dat"};
+
+    ValidationCache original{CACHE_BYTES, CACHE_BYTES};
+    std::vector<uint256> signature_entries, script_execution_entries;
+    for (int i{0}; i < 100; ++i) {
+        signature_entries.push_back(m_rng.rand256());
+        original.m_signature_cache.Set(signature_entries.back());
+        script_execution_entries.push_back(m_rng.rand256());
+        original.m_script_execution_cache.insert(script_execution_entries.back());
+    }
+    // Entries marked for erasure, as done when connecting a block, are not saved.
+    BOOST_CHECK(original.m_signature_cache.Get(signature_entries.back(), /*erase=*/true));
+    BOOST_CHECK(original.m_script_execution_cache.contains(script_execution_entries.back(), /*erase=*/true));
+    BOOST_REQUIRE(DumpSigCache(original, path));
+
+    ValidationCache loaded{CACHE_BYTES, CACHE_BYTES};
+    BOOST_CHECK(loaded.m_signature_cache.GetNonce() != original.m_signature_cache.GetNonce());
+    BOOST_CHECK(loaded.ScriptExecutionCacheNonce() != original.ScriptExecutionCacheNonce());
+    BOOST_REQUIRE(LoadSigCache(loaded, path));
+
+    // Entries are salted with the saved nonces, so that new lookups hit.
+    BOOST_CHECK(loaded.m_signature_cache.GetNonce() == original.m_signature_cache.GetNonce());
+    BOOST_CHECK(loaded.ScriptExecutionCacheNonce() == original.ScriptExecutionCacheNonce());
+    const uint256 sighash{m_rng.rand256()};
+    const std::vector<unsigned char> sig(64, 1);
+    const XOnlyPubKey pubkey{XOnlyPubKey::NUMS_H};
+    uint256 original_entry, loaded_entry;
+    original.m_signature_cache.ComputeEntrySchnorr(original_entry, sighash, sig, pubkey);
+    loaded.m_signature_cache.ComputeEntrySchnorr(loaded_entry, sighash, sig, pubkey);
+    BOOST_CHECK(original_entry == loaded_entry);
+    original.ScriptExecutionCacheHasher().Write(sighash.begin(), 32).Finalize(original_entry.begin());
+    loaded.ScriptExecutionCacheHasher().Write(sighash.begin(), 32).Finalize(loaded_entry.begin());
+    BOOST_CHECK(original_entry == loaded_entry);
+
+    for (size_t i{0}; i < signature_entries.size() - 1; ++i) {
+        BOOST_CHECK(loaded.m_signature_cache.Get(signature_entries[i], /*erase=*/false));
+        BOOST_CHECK(loaded.m_script_execution_cache.contains(script_execution_entries[i], /*erase=*/false));
+    }
+    BOOST_CHECK(!loaded.m_signature_cache.Get(signature_entries.back(), /*erase=*/false));
+    BOOST_CHECK(!loaded.m_script_execution_cache.contains(script_execution_entries.back(), /*erase=*/false));
+}
+
+BOOST_AUTO_TEST_CASE(load_other_versions)
+{
+    LOCK(::cs_main);
+    const fs::path path{m_args.GetDataDirNet() / "sigcache.dat"};
+    const uint256 signature_nonce{m_rng.rand256()}, script_execution_nonce{m_rng.rand256()};
+    const std::vector<uint256> signature_entries{m_rng.rand256()}, script_execution_entries{m_rng.rand256()};
+    const auto write_file{[&](uint64_t version, int client_version) {
+        AutoFile file{fsbridge::fopen(path, "wb")};
+        file << version << client_version << signature_nonce << signature_entries << script_execution_nonce << script_execution_entries;
+        BOOST_REQUIRE_EQUAL(file.fclose(), 0);
+    }};
+
+    // A file in an unknown format is ignored.
+    write_file(/*version=*/2, CLIENT_VERSION);
+    ValidationCache unknown_format{CACHE_BYTES, CACHE_BYTES};
+    BOOST_CHECK(!LoadSigCache(unknown_format, path));
+    BOOST_CHECK(unknown_format.m_signature_cache.GetNonce() != signature_nonce);
+    BOOST_CHECK(!unknown_format.m_signature_cache.Get(signature_entries[0], /*erase=*/false));
+
+    // Script execution cache entries written by another client version are
+    // ignored, signature cache entries are still valid.
+    write_file(/*version=*/1, CLIENT_VERSION - 1);
+    ValidationCache other_client{CACHE_BYTES, CACHE_BYTES};
+    BOOST_CHECK(LoadSigCache(other_client, path));
+    BOOST_CHECK(other_client.m_signature_cache.GetNonce() == signature_nonce);
+    BOOST_CHECK(other_client.m_signature_cache.Get(signature_entries[0], /*erase=*/false));
+    BOOST_CHECK(other_client.ScriptExecutionCacheNonce() != script_execution_nonce);
+    BOOST_CHECK(!other_client.m_script_execution_cache.contains(script_execution_entries[0], /*erase=*/false));
+
+    // A missing or truncated file is ignored.
+    BOOST_CHECK(!LoadSigCache(other_client, path + ".missing"));
+    {
+        AutoFile file{fsbridge::fopen(path, "wb")};
+        file << uint64_t{1} << CLIENT_VERSION;
+        BOOST_REQUIRE_EQUAL(file.fclose(), 0);
+    }
+    BOOST_CHECK(!LoadSigCache(other_client, path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
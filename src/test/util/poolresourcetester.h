@@ -76,14 +76,18 @@ public:
     {
         // collect all free blocks by iterating all freelists
         std::vector<PtrAndBytes> free_blocks;
+        std::size_t free_list_bytes = 0;
         for (std::size_t freelist_idx = 0; freelist_idx < resource.m_free_lists.size(); ++freelist_idx) {
             std::size_t bytes = freelist_idx * resource.ELEM_ALIGN_BYTES;
             auto* ptr = resource.m_free_lists[freelist_idx];
             while (ptr != nullptr) {
                 free_blocks.emplace_back(ptr, bytes);
+                free_list_bytes += bytes;
                 ptr = ptr->m_next;
             }
         }
+        // the freelists' total size is tracked
+        assert(free_list_bytes == resource.NumFreeListBytes());
         // also add whatever has not yet been used for blocks
         auto num_available_bytes = resource.m_available_memory_end - resource.m_available_memory_it;
         if (num_available_bytes > 0) {
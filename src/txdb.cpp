@@ -12,6 +12,8 @@
 #include <random.h>
 #include <serialize.h>
 #include <uint256.h>
+#include <util/thread.h>
+#include <util/time.h>
 #include <util/vector.h>
 
 #include <cassert>
@@ -51,11 +53,17 @@ CCoinsViewDB::CCoinsViewDB(DBParams db_params, CoinsViewOptions options) :
     m_options{std::move(options)},
     m_db{std::make_unique<CDBWrapper>(m_db_params)} { }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    WaitForWrite();
+}
+
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
     // We can't do this operation with an in-memory DB since we'll lose all the coins upon
     // reset.
     if (!m_db_params.memory_only) {
+        WaitForWrite();
         // Have to do a reset first to get the original `m_db` state to release its
         // filesystem lock.
         m_db.reset();
@@ -65,15 +73,39 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
     }
 }
 
+std::optional<Coin> CCoinsViewDB::GetPendingCoin(const COutPoint& outpoint) const
+{
+    if (!m_options.background_flush) return std::nullopt;
+    LOCK(m_pending_mutex);
+    if (!m_pending) return std::nullopt;
+    const auto it{m_pending->coins.find(outpoint)};
+    if (it == m_pending->coins.end()) return std::nullopt;
+    return it->second;
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (auto pending{GetPendingCoin(outpoint)}) {
+        if (pending->IsSpent()) return false;
+        coin = std::move(*pending);
+        return true;
+    }
     return m_db->Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (auto pending{GetPendingCoin(outpoint)}) return !pending->IsSpent();
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (m_options.background_flush) {
+        LOCK(m_pending_mutex);
+        if (m_pending) return m_pending->best_block;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -88,13 +120,13 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) {
+template <typename ForEachCoin>
+bool CCoinsViewDB::WriteCoins(const uint256& hashBlock, ForEachCoin&& for_each_coin) {
     CDBBatch batch(*m_db);
-    size_t count = 0;
     size_t changed = 0;
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -114,17 +146,13 @@ bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashB
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
-    for (auto it{cursor.Begin()}; it != cursor.End();) {
-        if (it->second.IsDirty()) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
-            changed++;
-        }
-        count++;
-        it = cursor.NextAndMaybeErase(*it);
+    const size_t count{for_each_coin([&](const COutPoint& outpoint, const Coin& coin) {
+        CoinEntry entry(&outpoint);
+        if (coin.IsSpent())
+            batch.Erase(entry);
+        else
+            batch.Write(entry, coin);
+        changed++;
         if (batch.SizeEstimate() > m_options.batch_write_bytes) {
             LogDebug(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
@@ -137,7 +165,7 @@ bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashB
                 }
             }
         }
-    }
+    })};
 
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
@@ -149,6 +177,96 @@ bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashB
     return ret;
 }
 
+bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) {
+    // Count the write both before and after it, so that a count taken while
+    // it is in progress differs from the one after it.
+    ++m_write_count;
+    const bool ok{DoBatchWrite(cursor, hashBlock)};
+    ++m_write_count;
+    return ok;
+}
+
+bool CCoinsViewDB::DoBatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) {
+    if (!m_options.background_flush) {
+        return WriteCoins(hashBlock, [&](const auto& write) {
+            size_t count = 0;
+            for (auto it{cursor.Begin()}; it != cursor.End();) {
+                if (it->second.IsDirty()) write(it->first, it->second.coin);
+                count++;
+                it = cursor.NextAndMaybeErase(*it);
+            }
+            return count;
+        });
+    }
+
+    // Only one write may be in progress, so that the database goes through
+    // every best block it was flushed at in order.
+    if (!WaitForWrite()) return false;
+    assert(!hashBlock.IsNull());
+
+    auto pending{std::make_shared<PendingWrite>()};
+    pending->best_block = hashBlock;
+    {
+        // Publish the pending write before the cursor drops any entry from the
+        // cache, and hold the lock while filling it, so that concurrent readers
+        // falling through the cache never see the database's outdated coins.
+        LOCK(m_pending_mutex);
+        m_pending = pending;
+        for (auto it{cursor.Begin()}; it != cursor.End();) {
+            if (it->second.IsDirty()) {
+                // Move the coin if the entry is going to be erased anyway.
+                pending->coins.insert_or_assign(it->first, cursor.WillErase(*it) ? std::move(it->second.coin) : it->second.coin);
+            }
+            it = cursor.NextAndMaybeErase(*it);
+        }
+    }
+    LogDebug(BCLog::COINDB, "Writing %u changed transaction outputs to coin database in the background\n", (unsigned int)pending->coins.size());
+    m_write_thread = std::thread(&util::TraceThread, "coinsflush", [this, pending = std::move(pending)] { BackgroundWrite(pending); });
+    return true;
+}
+
+void CCoinsViewDB::BackgroundWrite(std::shared_ptr<const PendingWrite> pending)
+{
+    const auto start{SteadyClock::now()};
+    bool ok{false};
+    try {
+        ok = WriteCoins(pending->best_block, [&](const auto& write) {
+            for (const auto& [outpoint, coin] : pending->coins) write(outpoint, coin);
+            return pending->coins.size();
+        });
+    } catch (const std::exception& e) {
+        LogError("Failed to write to coin database in the background: %s\n", e.what());
+    }
+    const auto duration{SteadyClock::now() - start};
+    LOCK(m_pending_mutex);
+    m_write_stats.last_write = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+    if (ok) {
+        m_pending.reset();
+    } else {
+        // Keep serving reads from the pending coins, the database is not consistent with them.
+        m_write_failed = true;
+    }
+}
+
+bool CCoinsViewDB::WaitForWrite()
+{
+    if (m_write_thread.joinable()) {
+        const auto start{SteadyClock::now()};
+        m_write_thread.join();
+        const auto stall{SteadyClock::now() - start};
+        LOCK(m_pending_mutex);
+        m_write_stats.total_stall += std::chrono::duration_cast<std::chrono::microseconds>(stall);
+    }
+    LOCK(m_pending_mutex);
+    return !m_write_failed;
+}
+
+CoinsDBWriteStats CCoinsViewDB::GetWriteStats() const
+{
+    LOCK(m_pending_mutex);
+    return m_write_stats;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
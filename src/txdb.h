@@ -12,10 +12,14 @@
 #include <sync.h>
 #include <util/fs.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 class COutPoint;
@@ -25,6 +29,15 @@ class uint256;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -coinscacheevict default
+static const int64_t DEFAULT_COINS_CACHE_EVICT_PERCENT = 0;
+//! -dbbackgroundflush default
+static const bool DEFAULT_DB_BACKGROUND_FLUSH = false;
+//! -coinscacheshards default. Sharding only pays off for concurrent readers,
+//! and costs a lock and a second hash per access otherwise.
+static const int64_t DEFAULT_COINS_CACHE_SHARDS = 1;
+//! max. -coinscacheshards
+static const int64_t MAX_COINS_CACHE_SHARDS = 256;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
 //! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
@@ -45,17 +58,76 @@ struct CoinsViewOptions {
     //! If non-zero, randomly exit when the database is flushed with (1/ratio)
     //! probability.
     int simulate_crash_ratio = 0;
+    //! Number of shards of the coins cache on top of the database. With more
+    //! than one, the cache supports concurrent reads through CCoinsViewCache::PeekCoin.
+    size_t cache_shards = 1;
+    //! Write batches to the database from a background thread. BatchWrite
+    //! then only snapshots the dirty coins and returns.
+    bool background_flush = DEFAULT_DB_BACKGROUND_FLUSH;
+    //! Percentage of its size limit to shrink the coins cache by when it is
+    //! full, evicting the least recently used entries first. If zero, the
+    //! whole cache is emptied instead.
+    unsigned cache_evict_percent = DEFAULT_COINS_CACHE_EVICT_PERCENT;
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+//! Timing of the writes to a CCoinsViewDB.
+struct CoinsDBWriteStats {
+    //! Duration of the most recently completed write to the database.
+    std::chrono::microseconds last_write{0};
+    //! Total time BatchWrite waited for a previous background write to complete.
+    std::chrono::microseconds total_stall{0};
+};
+
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With CoinsViewOptions::background_flush, BatchWrite copies the dirty coins
+ * into a pending write and returns, and the database is updated by a
+ * background thread. The pending coins take precedence over the database for
+ * reads until the write completes, so the view stays consistent with what was
+ * written to it. The database itself goes through the same head blocks
+ * transition as for a synchronous write, so a crash in the middle of it is
+ * recovered from on restart.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
     DBParams m_db_params;
     CoinsViewOptions m_options;
     std::unique_ptr<CDBWrapper> m_db;
+    std::atomic<uint64_t> m_write_count{0};
+
+    //! Coins being written in the background, keyed by outpoint. Spent coins are erased from the database.
+    struct PendingWrite {
+        std::unordered_map<COutPoint, Coin, SaltedOutpointHasher> coins;
+        uint256 best_block;
+    };
+
+    mutable Mutex m_pending_mutex;
+    //! The write in progress, if any. Not modified after the write thread has been started.
+    std::shared_ptr<const PendingWrite> m_pending GUARDED_BY(m_pending_mutex);
+    //! Whether a background write failed, leaving the database inconsistent.
+    bool m_write_failed GUARDED_BY(m_pending_mutex){false};
+    CoinsDBWriteStats m_write_stats GUARDED_BY(m_pending_mutex);
+    std::thread m_write_thread;
+
+    //! Read the best block as stored in the database, ignoring any pending write.
+    uint256 ReadBestBlock() const;
+
+    //! Write coins to the database in batches, marking it as transitioning to hashBlock until the last batch.
+    template <typename ForEachCoin>
+    bool WriteCoins(const uint256& hashBlock, ForEachCoin&& for_each_coin);
+
+    bool DoBatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock);
+
+    void BackgroundWrite(std::shared_ptr<const PendingWrite> pending) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    //! Look up a coin in the pending write. Returns std::nullopt if it is not part of it, and a spent coin if it is being erased.
+    std::optional<Coin> GetPendingCoin(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
 public:
     explicit CCoinsViewDB(DBParams db_params, CoinsViewOptions options);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -69,7 +141,17 @@ public:
     size_t EstimateSize() const override;
 
     //! Dynamically alter the underlying leveldb cache size.
-    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main, !m_pending_mutex);
+
+    //! Wait for the background write in progress, if any, to complete.
+    //! @returns false if a background write failed.
+    bool WaitForWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    CoinsDBWriteStats GetWriteStats() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    //! Counter changed by every BatchWrite call. Safe to call from any thread,
+    //! so that coins read concurrently can be checked not to predate a write.
+    uint64_t GetWriteCount() const { return m_write_count.load(); }
 
     //! @returns filesystem path to on-disk storage or std::nullopt if in memory.
     std::optional<fs::path> StoragePath() { return m_db->StoragePath(); }
@@ -6,6 +6,7 @@
 #include <txmempool.h>
 
 #include <chain.h>
+#include <cluster_linearize.h>
 #include <coins.h>
 #include <common/system.h>
 #include <consensus/consensus.h>
@@ -16,6 +17,7 @@
 #include <policy/settings.h>
 #include <random.h>
 #include <tinyformat.h>
+#include <util/bitset.h>
 #include <util/check.h>
 #include <util/feefrac.h>
 #include <util/moneystr.h>
@@ -31,7 +33,9 @@
 #include <numeric>
 #include <optional>
 #include <ranges>
+#include <set>
 #include <string_view>
+#include <unordered_set>
 #include <utility>
 
 bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
@@ -411,6 +415,10 @@ static CTxMemPool::Options&& Flatten(CTxMemPool::Options&& opts, bilingual_str&
 CTxMemPool::CTxMemPool(Options opts, bilingual_str& error)
     : m_opts{Flatten(std::move(opts), error)}
 {
+    if (m_opts.linearization_threads > 0) {
+        m_linearization_queue = std::make_unique<CCheckQueue<cluster_linearize::LinearizationJob<ClusterSetType>>>(
+            /*batch_size=*/1, m_opts.linearization_threads, /*thread_name=*/"linearize");
+    }
 }
 
 bool CTxMemPool::isSpent(const COutPoint& outpoint) const
@@ -525,6 +533,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    InvalidateCluster(*it);
     mapTx.erase(it);
     nTransactionsUpdated++;
 }
@@ -626,6 +635,84 @@ void CTxMemPool::removeConflicts(const CTransaction &tx)
     }
 }
 
+void CTxMemPool::RemoveMinedStaged(const setEntries& mined)
+{
+    AssertLockHeld(cs);
+    // Transactions in a block normally only have ancestors in the same block.
+    // Collect any other in-mempool ancestor, before the links needed to find
+    // it are severed, to recompute its descendant state once they are gone.
+    setEntries ancestors_left;
+    for (txiter it : mined) {
+        for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+            const txiter parent_it{mapTx.iterator_to(parent)};
+            if (mined.count(parent_it) || !ancestors_left.insert(parent_it).second) continue;
+            const auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *parent_it, Limits::NoLimits(), /*fSearchForParents=*/false)};
+            ancestors_left.insert(ancestors.begin(), ancestors.end());
+        }
+    }
+    for (txiter it : mined) {
+        ancestors_left.erase(it);
+    }
+
+    // Collect the descendants staying in the mempool once, however many of
+    // their ancestors are mined, and sever their links to the mined ones.
+    setEntries affected;
+    for (txiter it : mined) {
+        CalculateDescendants(it, affected);
+    }
+    for (txiter it : mined) {
+        affected.erase(it);
+        for (const CTxMemPoolEntry& child : it->GetMemPoolChildrenConst()) {
+            const txiter child_it{mapTx.iterator_to(child)};
+            if (!mined.count(child_it)) UpdateParent(child_it, it, false);
+        }
+        for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+            const txiter parent_it{mapTx.iterator_to(parent)};
+            if (!mined.count(parent_it)) UpdateChild(parent_it, it, false);
+        }
+    }
+    for (txiter it : mined) {
+        removeUnchecked(it, MemPoolRemovalReason::BLOCK);
+    }
+
+    // Recompute the descendant state of the ancestors left from their remaining
+    // descendants, and the ancestor state of the descendants left from their
+    // remaining ancestors.
+    for (txiter it : ancestors_left) {
+        setEntries descendants;
+        CalculateDescendants(it, descendants);
+        int64_t count{0};
+        int64_t size{0};
+        CAmount fees{0};
+        for (txiter descendant : descendants) {
+            ++count;
+            size += descendant->GetTxSize();
+            fees += descendant->GetModifiedFee();
+        }
+        mapTx.modify(it, [&](CTxMemPoolEntry& e) {
+            e.UpdateDescendantState(int32_t(size - e.GetSizeWithDescendants()), fees - e.GetModFeesWithDescendants(),
+                                    count - int64_t(e.GetCountWithDescendants()));
+        });
+    }
+    for (txiter it : affected) {
+        const auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits(), /*fSearchForParents=*/false)};
+        int64_t count{1};
+        int64_t size{it->GetTxSize()};
+        CAmount fees{it->GetModifiedFee()};
+        int64_t sigops{it->GetSigOpCost()};
+        for (txiter ancestor : ancestors) {
+            ++count;
+            size += ancestor->GetTxSize();
+            fees += ancestor->GetModifiedFee();
+            sigops += ancestor->GetSigOpCost();
+        }
+        mapTx.modify(it, [&](CTxMemPoolEntry& e) {
+            e.UpdateAncestorState(int32_t(size - e.GetSizeWithAncestors()), fees - e.GetModFeesWithAncestors(),
+                                  count - int64_t(e.GetCountWithAncestors()), sigops - e.GetSigOpCostWithAncestors());
+        });
+    }
+}
+
 /**
  * Called when a block is connected. Removes from mempool.
  */
@@ -634,18 +721,35 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     AssertLockHeld(cs);
     std::vector<RemovedMempoolTransactionInfo> txs_removed_for_block;
     txs_removed_for_block.reserve(vtx.size());
-    for (const auto& tx : vtx)
-    {
+    setEntries mined;
+    for (const auto& tx : vtx) {
         txiter it = mapTx.find(tx->GetHash());
         if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
+            mined.insert(it);
             txs_removed_for_block.emplace_back(*it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
         }
+    }
+    // The clusters split by the block are linearized again in one go below,
+    // if there are threads to do so.
+    std::vector<uint256> neighbours;
+    if (m_linearization_queue) {
+        for (txiter it : mined) {
+            for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) neighbours.push_back(parent.GetTx().GetHash());
+            for (const CTxMemPoolEntry& child : it->GetMemPoolChildrenConst()) neighbours.push_back(child.GetTx().GetHash());
+        }
+    }
+    RemoveMinedStaged(mined);
+    for (const auto& tx : vtx) {
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
+    if (!neighbours.empty()) {
+        std::vector<txiter> left;
+        for (const uint256& hash : neighbours) {
+            if (const auto it{GetIter(hash)}) left.push_back(*it);
+        }
+        LinearizeClusters(left, BLOCK_LINEARIZATION_ITERATIONS);
+    }
     if (m_opts.signals) {
         m_opts.signals->MempoolTransactionsRemovedForBlock(txs_removed_for_block, nBlockHeight);
     }
@@ -883,6 +987,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, [&nFeeDelta](CTxMemPoolEntry& e) { e.UpdateModifiedFee(nFeeDelta); });
+            InvalidateCluster(*it);
             // Now update all ancestors' modified fees with descendants
             auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits(), /*fSearchForParents=*/false)};
             for (txiter ancestorIt : ancestors) {
@@ -1028,7 +1133,7 @@ void CCoinsViewMemPool::Reset()
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + memusage::DynamicUsage(m_cluster_linearizations) + m_cluster_linearizations_usage + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1079,7 +1184,11 @@ void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
     } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
         cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    } else {
+        return;
     }
+    InvalidateCluster(*entry);
+    InvalidateCluster(*child);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
@@ -1090,9 +1199,149 @@ void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
     } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
         cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    } else {
+        return;
+    }
+    InvalidateCluster(*entry);
+    InvalidateCluster(*parent);
+}
+
+static size_t ClusterLinearizationUsage(const std::shared_ptr<const CTxMemPool::ClusterLinearization>& linearization)
+{
+    return memusage::DynamicUsage(linearization) + memusage::DynamicUsage(linearization->txs) + memusage::DynamicUsage(linearization->chunks);
+}
+
+void CTxMemPool::InvalidateCluster(const CTxMemPoolEntry& entry)
+{
+    AssertLockHeld(cs);
+    const auto found{m_cluster_linearizations.find(&entry)};
+    if (found == m_cluster_linearizations.end()) return;
+    // Keep the linearization alive while its members are erased from the cache.
+    const auto linearization{found->second};
+    m_cluster_linearizations_usage -= ClusterLinearizationUsage(linearization);
+    for (const txiter& tx : linearization->txs) {
+        m_cluster_linearizations.erase(&*tx);
     }
 }
 
+std::optional<std::vector<CTxMemPool::txiter>> CTxMemPool::CollectCluster(txiter it) const
+{
+    AssertLockHeld(cs);
+    // Collect the cluster, giving up as soon as it grows too large to linearize.
+    std::vector<txiter> cluster{it};
+    WITH_FRESH_EPOCH(m_epoch);
+    visited(it);
+    const auto add_to_cluster{[&](const CTxMemPoolEntry& entry) EXCLUSIVE_LOCKS_REQUIRED(cs, m_epoch) {
+        const auto entry_it{mapTx.iterator_to(entry)};
+        if (!visited(entry_it)) cluster.push_back(entry_it);
+    }};
+    for (size_t i{0}; i < cluster.size(); ++i) {
+        if (cluster.size() > MAX_CLUSTER_LINEARIZATION_COUNT) return std::nullopt;
+        const txiter tx{cluster[i]};
+        for (const CTxMemPoolEntry& parent : tx->GetMemPoolParentsConst()) add_to_cluster(parent);
+        for (const CTxMemPoolEntry& child : tx->GetMemPoolChildrenConst()) add_to_cluster(child);
+    }
+    if (cluster.size() > MAX_CLUSTER_LINEARIZATION_COUNT) return std::nullopt;
+    return cluster;
+}
+
+cluster_linearize::DepGraph<CTxMemPool::ClusterSetType> CTxMemPool::BuildDepGraph(const std::vector<txiter>& cluster) const
+{
+    AssertLockHeld(cs);
+    cluster_linearize::DepGraph<ClusterSetType> depgraph;
+    for (const txiter& tx : cluster) {
+        depgraph.AddTransaction({tx->GetModifiedFee(), tx->GetTxSize()});
+    }
+    for (cluster_linearize::ClusterIndex i{0}; i < cluster.size(); ++i) {
+        for (const CTxMemPoolEntry& parent : cluster[i]->GetMemPoolParentsConst()) {
+            const auto pos{std::find(cluster.begin(), cluster.end(), mapTx.iterator_to(parent))};
+            depgraph.AddDependency(pos - cluster.begin(), i);
+        }
+    }
+    return depgraph;
+}
+
+std::shared_ptr<const CTxMemPool::ClusterLinearization> CTxMemPool::CacheClusterLinearization(const std::vector<txiter>& cluster, const cluster_linearize::DepGraph<ClusterSetType>& depgraph,
+                                                                                              Span<const cluster_linearize::ClusterIndex> linearization, bool optimal)
+{
+    AssertLockHeld(cs);
+    auto result{std::make_shared<ClusterLinearization>()};
+    result->txs.reserve(linearization.size());
+    for (const cluster_linearize::ClusterIndex i : linearization) {
+        result->txs.push_back(cluster[i]);
+    }
+    result->chunks = cluster_linearize::ChunkLinearization(depgraph, linearization);
+    result->optimal = optimal;
+
+    std::shared_ptr<const ClusterLinearization> cached{std::move(result)};
+    m_cluster_linearizations_usage += ClusterLinearizationUsage(cached);
+    for (const txiter& tx : cached->txs) {
+        m_cluster_linearizations.emplace(&*tx, cached);
+    }
+    return cached;
+}
+
+std::shared_ptr<const CTxMemPool::ClusterLinearization> CTxMemPool::GetClusterLinearization(txiter it)
+{
+    AssertLockHeld(cs);
+    if (const auto found{m_cluster_linearizations.find(&*it)}; found != m_cluster_linearizations.end()) {
+        return found->second;
+    }
+    const auto cluster{CollectCluster(it)};
+    if (!cluster) return nullptr;
+    const auto depgraph{BuildDepGraph(*cluster)};
+    auto [linearization, optimal]{cluster_linearize::Linearize(depgraph, CLUSTER_LINEARIZATION_ITERATIONS, FastRandomContext().rand64())};
+    cluster_linearize::PostLinearize(depgraph, linearization);
+    return CacheClusterLinearization(*cluster, depgraph, linearization, optimal);
+}
+
+size_t CTxMemPool::LinearizeClusters(const std::vector<txiter>& txs, uint64_t max_iterations)
+{
+    AssertLockHeld(cs);
+    std::vector<std::vector<txiter>> clusters;
+    std::vector<cluster_linearize::DepGraph<ClusterSetType>> depgraphs;
+    std::unordered_set<const CTxMemPoolEntry*> collected;
+    for (const txiter& it : txs) {
+        if (m_cluster_linearizations.count(&*it) || collected.count(&*it)) continue;
+        auto cluster{CollectCluster(it)};
+        if (!cluster) continue;
+        for (const txiter& tx : *cluster) collected.insert(&*tx);
+        depgraphs.push_back(BuildDepGraph(*cluster));
+        clusters.push_back(std::move(*cluster));
+    }
+
+    const auto results{cluster_linearize::LinearizeClusters<ClusterSetType>(depgraphs, {}, max_iterations, FastRandomContext().rand64(), m_linearization_queue.get())};
+    for (size_t i{0}; i < clusters.size(); ++i) {
+        CacheClusterLinearization(clusters[i], depgraphs[i], results[i].first, results[i].second);
+    }
+    return clusters.size();
+}
+
+size_t CTxMemPool::ImproveClusterLinearizations(uint64_t max_iterations)
+{
+    AssertLockHeld(cs);
+    // Build the dependency graphs in the order of the cached linearizations,
+    // which are then the identity permutation to start improving from.
+    std::vector<std::vector<txiter>> clusters;
+    std::vector<cluster_linearize::DepGraph<ClusterSetType>> depgraphs;
+    std::vector<std::vector<cluster_linearize::ClusterIndex>> old_linearizations;
+    std::set<const ClusterLinearization*> seen_clusters;
+    for (const auto& [entry, linearization] : m_cluster_linearizations) {
+        if (linearization->optimal || !seen_clusters.insert(linearization.get()).second) continue;
+        clusters.push_back(linearization->txs);
+        depgraphs.push_back(BuildDepGraph(clusters.back()));
+        old_linearizations.emplace_back(clusters.back().size());
+        std::iota(old_linearizations.back().begin(), old_linearizations.back().end(), 0);
+    }
+
+    const auto results{cluster_linearize::LinearizeClusters<ClusterSetType>(depgraphs, old_linearizations, max_iterations, FastRandomContext().rand64(), m_linearization_queue.get())};
+    for (size_t i{0}; i < clusters.size(); ++i) {
+        InvalidateCluster(*clusters[i].front());
+        CacheClusterLinearization(clusters[i], depgraphs[i], results[i].first, results[i].second);
+    }
+    return clusters.size();
+}
+
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
     LOCK(cs);
     if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
@@ -1301,36 +1550,17 @@ util::Result<std::pair<std::vector<FeeFrac>, std::vector<FeeFrac>>> CTxMemPool::
     // ancestor feerate.
 
     std::vector<FeeFrac> old_chunks;
-    // Step 1: build the old diagram.
-
-    // The above clusters are all trivially linearized;
-    // they have a strict topology of 1 or two connected transactions.
-
-    // OLD: Compute existing chunks from all affected clusters
+    // Step 1: build the old diagram from the chunks of every cluster affected
+    // by the conflicts. Members of one cluster share a single linearization.
+    std::set<const ClusterLinearization*> seen_clusters;
     for (auto txiter : all_conflicts) {
-        // Does this transaction have descendants?
-        if (txiter->GetCountWithDescendants() > 1) {
-            // Consider this tx when we consider the descendant.
-            continue;
+        const auto linearization{GetClusterLinearization(txiter)};
+        if (!linearization) {
+            return util::Error{Untranslated(strprintf("%s is in a cluster of more than %u transactions",
+                                                      txiter->GetSharedTx()->GetHash().ToString(), MAX_CLUSTER_LINEARIZATION_COUNT))};
         }
-        // Does this transaction have ancestors?
-        FeeFrac individual{txiter->GetModifiedFee(), txiter->GetTxSize()};
-        if (txiter->GetCountWithAncestors() > 1) {
-            // We'll add chunks for either the ancestor by itself and this tx
-            // by itself, or for a combined package.
-            FeeFrac package{txiter->GetModFeesWithAncestors(), static_cast<int32_t>(txiter->GetSizeWithAncestors())};
-            if (individual >> package) {
-                // The individual feerate is higher than the package, and
-                // therefore higher than the parent's fee. Chunk these
-                // together.
-                old_chunks.emplace_back(package);
-            } else {
-                // Add two points, one for the parent and one for this child.
-                old_chunks.emplace_back(package - individual);
-                old_chunks.emplace_back(individual);
-            }
-        } else {
-            old_chunks.emplace_back(individual);
+        if (seen_clusters.insert(linearization.get()).second) {
+            old_chunks.insert(old_chunks.end(), linearization->chunks.begin(), linearization->chunks.end());
         }
     }
 
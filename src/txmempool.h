@@ -6,6 +6,8 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <checkqueue.h>
+#include <cluster_linearize.h>
 #include <coins.h>
 #include <consensus/amount.h>
 #include <indirectmap.h>
@@ -18,6 +20,7 @@
 #include <policy/packages.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <util/bitset.h>
 #include <util/epochguard.h>
 #include <util/hasher.h>
 #include <util/result.h>
@@ -32,11 +35,14 @@
 #include <boost/multi_index_container.hpp>
 
 #include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -395,6 +401,29 @@ public:
 
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
+    /** Clusters larger than this are not linearized, see GetClusterLinearization(). */
+    static constexpr unsigned MAX_CLUSTER_LINEARIZATION_COUNT{64};
+    /** Iteration budget passed to Linearize() for each cluster linearized on demand. */
+    static constexpr uint64_t CLUSTER_LINEARIZATION_ITERATIONS{10'000};
+    /** Iteration budget shared by the clusters linearized after a block is connected. */
+    static constexpr uint64_t BLOCK_LINEARIZATION_ITERATIONS{1'000'000};
+    /** Iteration budget shared by the clusters improved by each ImproveClusterLinearizations() call in idle time. */
+    static constexpr uint64_t IDLE_LINEARIZATION_ITERATIONS{100'000};
+    /** How often to call ImproveClusterLinearizations() in idle time, if linearization threads are enabled. */
+    static constexpr std::chrono::seconds IDLE_LINEARIZATION_INTERVAL{1};
+
+    using ClusterSetType = BitSet<MAX_CLUSTER_LINEARIZATION_COUNT>;
+
+    /** A linearization of a cluster of connected mempool transactions. */
+    struct ClusterLinearization {
+        /** All transactions of the cluster, in linearization order. */
+        std::vector<txiter> txs;
+        /** Feerates of the chunks of that linearization, highest first. */
+        std::vector<FeeFrac> chunks;
+        /** Whether the linearization is known to be optimal. */
+        bool optimal;
+    };
+
     using Limits = kernel::MemPoolLimits;
 
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -405,6 +434,24 @@ private:
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void UpdateChild(txiter entry, txiter child, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Cached cluster linearizations, keyed by each member of the cluster. */
+    std::unordered_map<const CTxMemPoolEntry*, std::shared_ptr<const ClusterLinearization>> m_cluster_linearizations GUARDED_BY(cs);
+    /** Dynamic memory usage of the distinct linearizations in m_cluster_linearizations. */
+    size_t m_cluster_linearizations_usage GUARDED_BY(cs){0};
+
+    /** Drop the cached linearization of the cluster that contains entry, if any. */
+    void InvalidateCluster(const CTxMemPoolEntry& entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Collect the cluster that contains it, or nullopt if it has more than MAX_CLUSTER_LINEARIZATION_COUNT transactions. */
+    std::optional<std::vector<txiter>> CollectCluster(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Build the dependency graph of a cluster, with transaction i of the graph being cluster[i]. */
+    cluster_linearize::DepGraph<ClusterSetType> BuildDepGraph(const std::vector<txiter>& cluster) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Cache a linearization of cluster, given as indices into it, for all of its members. */
+    std::shared_ptr<const ClusterLinearization> CacheClusterLinearization(const std::vector<txiter>& cluster, const cluster_linearize::DepGraph<ClusterSetType>& depgraph,
+                                                                          Span<const cluster_linearize::ClusterIndex> linearization, bool optimal) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Worker threads linearizing clusters, if enabled by Options::linearization_threads. */
+    std::unique_ptr<CCheckQueue<cluster_linearize::LinearizationJob<ClusterSetType>>> m_linearization_queue;
+
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /**
@@ -585,6 +632,21 @@ public:
      * more transactions as a DoS protection. */
     std::vector<txiter> GatherClusters(const std::vector<uint256>& txids) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Get the linearization of the cluster that contains it, using modified fees and virtual sizes.
+     * The result is cached for every member of the cluster until a transaction is added to or
+     * removed from it, or the fee of one of its members is prioritised. Returns nullptr if the
+     * cluster has more than MAX_CLUSTER_LINEARIZATION_COUNT transactions. */
+    std::shared_ptr<const ClusterLinearization> GetClusterLinearization(txiter it) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Linearize the clusters of the given transactions that have no cached linearization, sharing
+     * max_iterations among them. They are linearized concurrently if linearization threads are
+     * enabled. Returns the number of clusters linearized. */
+    size_t LinearizeClusters(const std::vector<txiter>& txs, uint64_t max_iterations) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Try to improve the cached linearizations that are not known to be optimal, starting from
+     * the cached ones and sharing max_iterations among them. Returns the number of clusters tried. */
+    size_t ImproveClusterLinearizations(uint64_t max_iterations) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Calculate all in-mempool ancestors of a set of transactions not already in the mempool and
      * check ancestor and descendant limits. Heuristics are used to estimate the ancestor and
      * descendant count of all entries if the package were to be added to the mempool.  The limits
@@ -787,6 +849,15 @@ private:
     void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /**
+     * Remove the transactions of a block. Instead of walking the descendants
+     * of each mined transaction to take it out of their ancestor state, the
+     * ancestor state of every remaining descendant is recomputed once, after
+     * all of them are gone. Cheaper when a block mines several ancestors of
+     * the same transactions, as is common after a reorg or with large
+     * packages.
+     */
+    void RemoveMinedStaged(const setEntries& mined) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /** Before calling removeUnchecked for a given transaction,
      *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
@@ -83,7 +83,10 @@ struct BlockHasher
     // this used to call `GetCheapHash()` in uint256, which was later moved; the
     // cheap hash function simply calls ReadLE64() however, so the end result is
     // identical
-    size_t operator()(const uint256& hash) const { return ReadLE64(hash.begin()); }
+    //
+    // Being noexcept, it lets libstdc++'s unordered_map recalculate the hash
+    // instead of caching it in every node of the block index.
+    size_t operator()(const uint256& hash) const noexcept { return ReadLE64(hash.begin()); }
 };
 
 class SaltedSipHasher
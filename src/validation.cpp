@@ -8,6 +8,7 @@
 #include <validation.h>
 
 #include <arith_uint256.h>
+#include <blockpreloader.h>
 #include <chain.h>
 #include <checkqueue.h>
 #include <clientversion.h>
@@ -64,6 +65,7 @@
 #include <validationinterface.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <deque>
@@ -73,6 +75,7 @@
 #include <span>
 #include <string>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 using kernel::CCoinsStats;
@@ -857,7 +860,7 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
         }
 
         // Note: this call may add txin.prevout to the coins cache
-        // (coins_cache.cacheCoins) by way of FetchCoin(). It should be removed
+        // (one of the coins_cache shards) by way of FetchCoin(). It should be removed
         // later (via coins_to_uncache) if this tx turns out to be invalid.
         if (!m_view.HaveCoin(txin.prevout)) {
             // Are inputs missing because we already have the tx?
@@ -1866,7 +1869,7 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
         // Remove coins that were not present in the coins cache before calling
         // AcceptSingleTransaction(); this is to prevent memory DoS in case we receive a large
         // number of invalid transactions that attempt to overrun the in-memory coins cache
-        // (`CCoinsViewCache::cacheCoins`).
+        // (`CCoinsViewCache::m_shards`).
 
         for (const COutPoint& hashTx : coins_to_uncache)
             active_chainstate.CoinsTip().Uncache(hashTx);
@@ -1927,13 +1930,14 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 }
 
 CoinsViews::CoinsViews(DBParams db_params, CoinsViewOptions options)
-    : m_dbview{std::move(db_params), std::move(options)},
+    : m_cache_shards{options.cache_shards},
+      m_dbview{std::move(db_params), std::move(options)},
       m_catcherview(&m_dbview) {}
 
 void CoinsViews::InitCache()
 {
     AssertLockHeld(::cs_main);
-    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview, /*deterministic=*/false, m_cache_shards);
 }
 
 Chainstate::Chainstate(
@@ -1982,6 +1986,13 @@ void Chainstate::InitCoinsCache(size_t cache_size_bytes)
     m_coins_views->InitCache();
 }
 
+void Chainstate::ResetCoinsViews()
+{
+    // Wait for any block being preloaded from these views.
+    m_chainman.GetBlockPreloader().Cancel();
+    m_coins_views.reset();
+}
+
 // Note that though this is marked const, we may end up modifying `m_cached_finished_ibd`, which
 // is a performance-related implementation detail. This function must be marked
 // `const` so that `CValidationInterface` clients (which are given a `const Chainstate*`)
@@ -2096,16 +2107,22 @@ ValidationCache::ValidationCache(const size_t script_execution_cache_bytes, cons
     : m_signature_cache{signature_cache_bytes}
 {
     // Setup the salted hasher
-    uint256 nonce = GetRandHash();
+    SetScriptExecutionCacheNonce(GetRandHash());
+
+    const auto [num_elems, approx_size_bytes] = m_script_execution_cache.setup_bytes(script_execution_cache_bytes);
+    LogPrintf("Using %zu MiB out of %zu MiB requested for script execution cache, able to store %zu elements\n",
+              approx_size_bytes >> 20, script_execution_cache_bytes >> 20, num_elems);
+}
+
+void ValidationCache::SetScriptExecutionCacheNonce(const uint256& nonce)
+{
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy twice to fill the 64 bytes.
+    m_script_execution_cache_nonce = nonce;
+    m_script_execution_cache_hasher.Reset();
     m_script_execution_cache_hasher.Write(nonce.begin(), 32);
     m_script_execution_cache_hasher.Write(nonce.begin(), 32);
-
-    const auto [num_elems, approx_size_bytes] = m_script_execution_cache.setup_bytes(script_execution_cache_bytes);
-    LogPrintf("Using %zu MiB out of %zu MiB requested for script execution cache, able to store %zu elements\n",
-              approx_size_bytes >> 20, script_execution_cache_bytes >> 20, num_elems);
 }
 
 /**
@@ -2742,6 +2759,14 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     return true;
 }
 
+//! Coins cache size above which it is LARGE, given the total space it may use.
+static int64_t LargeCoinsCacheThreshold(int64_t total_space)
+{
+    //! No need to periodic flush if at least this much space still available.
+    static constexpr int64_t MAX_BLOCK_COINSDB_USAGE_BYTES = 10 * 1024 * 1024;  // 10MB
+    return std::max((9 * total_space) / 10, total_space - MAX_BLOCK_COINSDB_USAGE_BYTES);
+}
+
 CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState()
 {
     AssertLockHeld(::cs_main);
@@ -2756,14 +2781,12 @@ CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState(
 {
     AssertLockHeld(::cs_main);
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // Memory of erased entries is reused by new ones before the cache grows.
+    int64_t cacheSize = CoinsTip().DynamicMemoryUsage() - CoinsTip().ReusableMemoryUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(int64_t(max_mempool_size_bytes) - nMempoolUsage, 0);
 
-    //! No need to periodic flush if at least this much space still available.
-    static constexpr int64_t MAX_BLOCK_COINSDB_USAGE_BYTES = 10 * 1024 * 1024;  // 10MB
-    int64_t large_threshold =
-        std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE_BYTES);
+    int64_t large_threshold = LargeCoinsCacheThreshold(nTotalSpace);
 
     if (cacheSize > nTotalSpace) {
         LogPrintf("Cache size (%s) exceeds total space (%s)\n", cacheSize, nTotalSpace);
@@ -2900,10 +2923,27 @@ bool Chainstate::FlushStateToDisk(
                 return FatalError(m_chainman.GetNotifications(), state, _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            const auto empty_cache{(mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical};
-            if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
+            const auto coins_flush_start{SteadyClock::now()};
+            // When the cache is full, either empty it or, with -coinscacheevict,
+            // only evict its least recently used entries and keep the rest of
+            // it warm. The cache is shrunk below the LARGE threshold computed
+            // from its own size limit alone, which is at most the one computed
+            // with the unused mempool space, so that it is not full again
+            // right away.
+            const auto evict_percent{m_chainman.m_options.coins_view.cache_evict_percent};
+            const auto empty_cache{(mode == FlushStateMode::ALWAYS) || ((fCacheLarge || fCacheCritical) && evict_percent == 0)};
+            const auto evict_cache{!empty_cache && (fCacheLarge || fCacheCritical)};
+            const size_t evict_to{size_t(LargeCoinsCacheThreshold(m_coinstip_cache_size_bytes)) * (100 - evict_percent) / 100};
+            if (empty_cache ? !CoinsTip().Flush() : evict_cache ? !CoinsTip().SyncAndEvict(evict_to) : !CoinsTip().Sync()) {
+                return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+            }
+            // With -dbbackgroundflush the coins are written to the database
+            // asynchronously. Explicit flushes expect them to be on disk, and
+            // pruned block files may be needed to replay an interrupted write.
+            if ((mode == FlushStateMode::ALWAYS || fFlushForPrune) && !CoinsDB().WaitForWrite()) {
                 return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
             }
+            m_last_coins_flush_duration = std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - coins_flush_start);
             m_last_flush = nNow;
             full_flush_completed = true;
             TRACE5(utxocache, flush,
@@ -3120,13 +3160,83 @@ public:
     }
 };
 
+/**
+ * Read a block from disk, run the context-free checks on it and look up its
+ * inputs in the coins database, stopping the lookups when interrupted. Runs
+ * on the BlockPreloader thread, so must not touch any chainstate member.
+ */
+static void LoadBlockAndInputs(BlockPreloader::Result& result, const std::atomic<bool>& interrupt,
+                               const BlockManager& blockman, const Consensus::Params& params, const CCoinsViewDB& db,
+                               const FlatFilePos& pos, const uint256& hash)
+{
+    auto block{std::make_shared<CBlock>()};
+    // On failure ConnectTip reads the block again and reports the error.
+    if (!blockman.ReadBlockFromDisk(*block, pos) || block->GetHash() != hash) return;
+    // Once passed, the checks are skipped when ConnectBlock runs them again.
+    BlockValidationState state;
+    const bool checked{CheckBlock(*block, state, params)};
+    result.block = block;
+    if (!checked) return;
+
+    result.coins_view = &db;
+    result.coins_view_writes = db.GetWriteCount();
+    std::unordered_set<Txid, SaltedTxidHasher> txids;
+    txids.reserve(block->vtx.size());
+    for (const auto& tx : block->vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn& txin : tx->vin) {
+                if (interrupt) return;
+                // Outputs created earlier in this block are not in the UTXO set yet.
+                if (txids.contains(txin.prevout.hash)) continue;
+                Coin coin;
+                if (db.GetCoin(txin.prevout, coin) && !coin.IsSpent()) {
+                    result.coins.emplace_back(txin.prevout, std::move(coin));
+                }
+            }
+        }
+        txids.insert(tx->GetHash());
+    }
+}
+
+void Chainstate::PreloadBlock(const CBlockIndex& index)
+{
+    AssertLockHeld(cs_main);
+    BlockPreloader& preloader{m_chainman.GetBlockPreloader()};
+    if (!preloader.IsEnabled() || !(index.nStatus & BLOCK_HAVE_DATA)) return;
+    preloader.Preload(index.GetBlockHash(),
+                      [&blockman = m_blockman, &params = m_chainman.GetConsensus(), &db = CoinsDB(), pos = index.GetBlockPos(), hash = index.GetBlockHash()](
+                          BlockPreloader::Result& result, const std::atomic<bool>& interrupt) {
+                          LoadBlockAndInputs(result, interrupt, blockman, params, db, pos, hash);
+                      });
+}
+
+std::shared_ptr<const CBlock> Chainstate::TakePreloadedBlock(const CBlockIndex& index)
+{
+    AssertLockHeld(cs_main);
+    auto preloaded{m_chainman.GetBlockPreloader().Take(index.GetBlockHash())};
+    if (!preloaded || !preloaded->block) return nullptr;
+    size_t inserted{0};
+    // A coin read before the database was last written to may have been spent
+    // and erased from the cache since, so only use coins read after it.
+    if (preloaded->coins_view == &CoinsDB() && preloaded->coins_view_writes == CoinsDB().GetWriteCount()) {
+        for (auto& [outpoint, coin] : preloaded->coins) {
+            if (CoinsTip().EmplaceCoinFromBase(outpoint, std::move(coin))) ++inserted;
+        }
+    }
+    LogDebug(BCLog::BENCH, "  - Using preloaded block (%u of %u prefetched inputs inserted)\n", inserted, preloaded->coins.size());
+    return std::move(preloaded->block);
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
  *
+ * If pindex_preload is set, that block, which is to be connected next, is
+ * prepared in the background while this one is being connected.
+ *
  * The block is added to connectTrace if connection succeeds.
  */
-bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
+bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex_preload, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
@@ -3134,16 +3244,16 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     assert(pindexNew->pprev == m_chain.Tip());
     // Read block from disk.
     const auto time_1{SteadyClock::now()};
-    std::shared_ptr<const CBlock> pthisBlock;
-    if (!pblock) {
+    std::shared_ptr<const CBlock> pthisBlock{pblock ? pblock : TakePreloadedBlock(*pindexNew)};
+    if (pindex_preload) PreloadBlock(*pindex_preload);
+    if (!pthisBlock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!m_blockman.ReadBlockFromDisk(*pblockNew, *pindexNew)) {
             return FatalError(m_chainman.GetNotifications(), state, _("Failed to read block."));
         }
         pthisBlock = pblockNew;
-    } else {
+    } else if (pblock) {
         LogDebug(BCLog::BENCH, "  - Using cached block\n");
-        pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
     // Apply the block atomically to the chain state.
@@ -3153,6 +3263,18 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     // num_blocks_total may be zero until the ConnectBlock() call below.
     LogDebug(BCLog::BENCH, "  - Load block from disk: %.2fms\n",
              Ticks<MillisecondsDouble>(time_2 - time_1));
+    if (m_chainman.GetInputFetcher().HasThreads()) {
+        // Warm the coins cache with the block's inputs using parallel database lookups,
+        // so that ConnectBlock below does not stall on them one at a time.
+        const auto stats{m_chainman.GetInputFetcher().FetchInputs(CoinsTip(), CoinsErrorCatcher(), blockConnecting)};
+        TRACE4(utxocache, prefetch,
+               pindexNew->nHeight,
+               (uint64_t)stats.inputs,
+               (uint64_t)stats.cache_hits,
+               (uint64_t)stats.fetched);
+        LogDebug(BCLog::BENCH, "  - Prefetch inputs: %.2fms (%u inputs, %u cached, %u fetched)\n",
+                 Ticks<MillisecondsDouble>(SteadyClock::now() - time_2), stats.inputs, stats.cache_hits, stats.fetched);
+    }
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
@@ -3350,7 +3472,10 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : vpindexToConnect | std::views::reverse) {
-            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            // Prepare the next block while this one is connected, unless it was provided.
+            const CBlockIndex* pindex_next{pindexConnect == pindexMostWork ? nullptr : pindexMostWork->GetAncestor(pindexConnect->nHeight + 1)};
+            if (pindex_next == pindexMostWork && pblock) pindex_next = nullptr;
+            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), pindex_next, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -5531,6 +5656,8 @@ bool Chainstate::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     size_t old_coinstip_size = m_coinstip_cache_size_bytes;
     m_coinstip_cache_size_bytes = coinstip_size;
     m_coinsdb_cache_size_bytes = coinsdb_size;
+    // Resizing reopens the database, which must not be read from meanwhile.
+    m_chainman.GetBlockPreloader().Cancel();
     CoinsDB().ResizeCache(coinsdb_size);
 
     LogPrintf("[%s] resized coinsdb cache to %.1f MiB\n",
@@ -6224,6 +6351,7 @@ void ChainstateManager::MaybeRebalanceCaches()
 
 void ChainstateManager::ResetChainstates()
 {
+    m_block_preloader.Cancel();
     m_ibd_chainstate.reset();
     m_snapshot_chainstate.reset();
     m_active_chainstate = nullptr;
@@ -6244,6 +6372,8 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
     : m_script_check_queue{/*batch_size=*/128, options.worker_threads_num},
+      m_input_fetcher{/*batch_size=*/16, options.prefetch_threads_num},
+      m_block_preloader{options.preload_blocks},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)},
@@ -6320,7 +6450,7 @@ util::Result<void> Chainstate::InvalidateCoinsDBOnDisk()
     fs::path snapshot_datadir = GetSnapshotCoinsDBPath(*this);
 
     // Coins views no longer usable.
-    m_coins_views.reset();
+    ResetCoinsViews();
 
     auto invalid_path = snapshot_datadir + "_INVALID";
     std::string dbpath = fs::PathToString(snapshot_datadir);
@@ -6353,6 +6483,7 @@ bool ChainstateManager::DeleteSnapshotChainstate()
     AssertLockHeld(::cs_main);
     Assert(m_snapshot_chainstate);
     Assert(m_ibd_chainstate);
+    m_block_preloader.Cancel();
 
     fs::path snapshot_datadir = Assert(node::FindSnapshotChainstateDir(m_options.datadir)).value();
     if (!DeleteCoinsDBFromDisk(snapshot_datadir, /*is_snapshot=*/ true)) {
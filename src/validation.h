@@ -8,11 +8,13 @@
 
 #include <arith_uint256.h>
 #include <attributes.h>
+#include <blockpreloader.h>
 #include <chain.h>
 #include <checkqueue.h>
 #include <consensus/amount.h>
 #include <cuckoocache.h>
 #include <deploymentstatus.h>
+#include <inputfetcher.h>
 #include <kernel/chain.h>
 #include <kernel/chainparams.h>
 #include <kernel/chainstatemanager_opts.h>
@@ -367,6 +369,8 @@ class ValidationCache
 private:
     //! Pre-initialized hasher to avoid having to recreate it for every hash calculation.
     CSHA256 m_script_execution_cache_hasher;
+    //! The random nonce the hasher is salted with.
+    uint256 m_script_execution_cache_nonce;
 
 public:
     CuckooCache::cache<uint256, SignatureCacheHasher> m_script_execution_cache;
@@ -379,6 +383,16 @@ public:
 
     //! Return a copy of the pre-initialized hasher.
     CSHA256 ScriptExecutionCacheHasher() const { return m_script_execution_cache_hasher; }
+
+    const uint256& ScriptExecutionCacheNonce() const { return m_script_execution_cache_nonce; }
+
+    /**
+     * Salt script execution cache entries with the given nonce from now on,
+     * e.g. to add entries saved by a previous run. Entries computed with the
+     * previous nonce stop matching. Must not be called while scripts are being
+     * checked.
+     */
+    void SetScriptExecutionCacheNonce(const uint256& nonce);
 };
 
 /** Functions for validating blocks and updating the block tree */
@@ -456,6 +470,8 @@ enum class FlushStateMode {
  * disk, `m_dbview`.
  */
 class CoinsViews {
+    //! Number of shards of m_cacheview.
+    const size_t m_cache_shards;
 
 public:
     //! The lowest level of the CoinsViews cache hierarchy sits in a leveldb database on disk.
@@ -640,7 +656,7 @@ public:
     }
 
     //! Destructs all objects related to accessing the UTXO set.
-    void ResetCoinsViews() { m_coins_views.reset(); }
+    void ResetCoinsViews();
 
     //! Does this chainstate have a UTXO set attached?
     bool HasCoinsViews() const { return (bool)m_coins_views; }
@@ -651,6 +667,10 @@ public:
     //! The cache size of the in-memory coins view.
     size_t m_coinstip_cache_size_bytes{0};
 
+    //! Time spent writing out the coins cache in the most recent full flush,
+    //! during which cs_main was held.
+    std::chrono::microseconds m_last_coins_flush_duration GUARDED_BY(::cs_main){0};
+
     //! Resize the CoinsViews caches dynamically and flush state to disk.
     //! @returns true unless an error occurred during the flush.
     bool ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
@@ -771,7 +791,12 @@ public:
 
 private:
     bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
-    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex_preload, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+
+    //! Start preparing a block to be connected in the background, see BlockPreloader.
+    void PreloadBlock(const CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Return the block if it was preloaded, after inserting its prefetched inputs into the coins cache.
+    std::shared_ptr<const CBlock> TakePreloadedBlock(const CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -949,6 +974,14 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! Worker threads warming the coins cache with the inputs of blocks about to be connected.
+    InputFetcher m_input_fetcher;
+
+    //! Thread preparing the next block to be connected. Declared after the
+    //! chainstates, whose coins views it may be reading from, so that it is
+    //! stopped before they are destroyed.
+    BlockPreloader m_block_preloader;
+
     //! Timers and counters used for benchmarking validation in both background
     //! and active chainstates.
     SteadyClock::duration GUARDED_BY(::cs_main) time_check{};
@@ -1316,6 +1349,10 @@ public:
 
     CCheckQueue<CScriptCheck>& GetCheckQueue() { return m_script_check_queue; }
 
+    InputFetcher& GetInputFetcher() { return m_input_fetcher; }
+
+    BlockPreloader& GetBlockPreloader() { return m_block_preloader; }
+
     ~ChainstateManager();
 };
 